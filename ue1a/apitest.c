@@ -0,0 +1,171 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ispalindrom.h"
+
+/** @defgroup Apitest */
+
+/** @addtogroup Apitest
+ * @brief Checks the batch and stream calls of libispalindrom
+ *
+ * @details Is linked against libispalindrom.so, so it only sees the exported functions. Checks
+ * the verdict bitmap of a batch that spans more than one word, and a stream whose lines are
+ * split across chunks, fed in one piece, in small chunks and byte by byte.
+ *
+ * @author Markus Krainz
+ * @date November 2018
+ *  @{
+ */
+
+#define STREAM_LINES 8
+
+/** The lines a stream passed to its callback */
+typedef struct received {
+  char lines[STREAM_LINES][16];
+  int verdicts[STREAM_LINES];
+  size_t count;
+} Received_t;
+
+static int checkBatch(char *name);
+static int checkStream(char *name, size_t chunk);
+static void receive(void *context, const char *line, size_t length, int verdict);
+
+int main(int argc, char *argv[]) {
+  (void)argc;
+  int failures = checkBatch(argv[0]);
+  // whole input, lines split across chunks, and byte by byte
+  const size_t chunks[] = {1024, 5, 1};
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+    failures += checkStream(argv[0], chunks[i]);
+  }
+
+  if (failures > 0) {
+    return EXIT_FAILURE;
+  }
+  printf("libispalindrom: batch and stream ok\n");
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Checks 70 lines as a batch, so the verdicts take two words
+ *
+ * @param name c_string of the name of the executable
+ * @return number of failed checks
+ */
+static int checkBatch(char *name) {
+  static const char *words[] = {"Anna", "anna", "ab b a", "abc"};
+  PalindromSpan_t spans[70];
+  for (size_t i = 0; i < 70; ++i) {
+    spans[i].data = words[i % 4];
+    spans[i].length = strlen(words[i % 4]);
+  }
+
+  int failures = 0;
+  const unsigned flags[] = {0, PALINDROM_IGNORE_CASE | PALINDROM_IGNORE_WHITESPACE};
+  // "anna" is a palindrome with any flags, "Anna" and "ab b a" only ignoring case and spaces
+  const unsigned palindromes[] = {0x2, 0x7};
+  for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); ++f) {
+    // the bits behind the last span have to be cleared
+    uint64_t verdicts[2] = {~(uint64_t)0, ~(uint64_t)0};
+    if (palindromCheckBatch(spans, 70, flags[f], verdicts) != 0) {
+      fprintf(stderr, "[%s, %s, %d] ERROR batch with flags %u failed \n", name, __FILE__,
+              __LINE__, flags[f]);
+      ++failures;
+      continue;
+    }
+    for (size_t i = 0; i < 128; ++i) {
+      const int expected = i < 70 && (palindromes[f] >> (i % 4) & 1) != 0;
+      if ((int)(verdicts[i / 64] >> (i % 64) & 1) != expected) {
+        fprintf(stderr, "[%s, %s, %d] ERROR bit %zu of the batch with flags %u is not %d \n",
+                name, __FILE__, __LINE__, i, flags[f], expected);
+        ++failures;
+      }
+    }
+  }
+
+  uint64_t verdict;
+  errno = 0;
+  if (palindromCheckBatch(spans, 1, 0x100, &verdict) != -1 || errno != EINVAL) {
+    fprintf(stderr, "[%s, %s, %d] ERROR unknown flags are not rejected \n", name, __FILE__,
+            __LINE__);
+    ++failures;
+  }
+  return failures;
+}
+
+/**
+ * @brief Feeds lines to a stream in chunks of the given size
+ *
+ * @detail The last line has no '\n', so it is only checked by palindromStreamFinish().
+ * @param name c_string of the name of the executable
+ * @param chunk bytes fed at once
+ * @return number of failed checks
+ */
+static int checkStream(char *name, size_t chunk) {
+  static const char input[] = "anna\nabc\n\nracecar\nab b a\nr\xcc\x81" "ar\xcc\x81\nxyz";
+  static const char *lines[] = {"anna", "abc", "", "racecar", "ab b a", "r\xcc\x81" "ar\xcc\x81",
+                                "xyz"};
+  static const int verdicts[] = {1, 0, 1, 1, 1, 1, 0};
+  const size_t count = sizeof(verdicts) / sizeof(verdicts[0]);
+
+  Received_t received = {.count = 0};
+  PalindromStream_t *stream = palindromStreamCreate(
+      PALINDROM_IGNORE_WHITESPACE | PALINDROM_GRAPHEMES, receive, &received);
+  if (stream == NULL) {
+    fprintf(stderr, "[%s, %s, %d] ERROR creating a stream failed: %s\n", name, __FILE__,
+            __LINE__, strerror(errno));
+    return 1;
+  }
+
+  int failures = 0;
+  const size_t length = strlen(input);
+  for (size_t pos = 0; pos < length; pos += chunk) {
+    const size_t size = length - pos < chunk ? length - pos : chunk;
+    if (palindromStreamFeed(stream, input + pos, size) != 0) {
+      fprintf(stderr, "[%s, %s, %d] ERROR feeding the stream failed: %s\n", name, __FILE__,
+              __LINE__, strerror(errno));
+      ++failures;
+    }
+  }
+  if (received.count != count - 1) {
+    fprintf(stderr, "[%s, %s, %d] ERROR %zu lines before the end in chunks of %zu \n", name,
+            __FILE__, __LINE__, received.count, chunk);
+    ++failures;
+  }
+  palindromStreamFinish(stream);
+  palindromStreamDestroy(stream);
+
+  if (received.count != count) {
+    fprintf(stderr, "[%s, %s, %d] ERROR %zu lines in chunks of %zu \n", name, __FILE__, __LINE__,
+            received.count, chunk);
+    return failures + 1;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (strcmp(received.lines[i], lines[i]) != 0 || received.verdicts[i] != verdicts[i]) {
+      fprintf(stderr, "[%s, %s, %d] ERROR line %zu is '%s' %d in chunks of %zu \n", name,
+              __FILE__, __LINE__, i, received.lines[i], received.verdicts[i], chunk);
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+/**
+ * @brief Records a line of the stream and its verdict
+ */
+static void receive(void *context, const char *line, size_t length, int verdict) {
+  Received_t *received = context;
+  if (received->count == STREAM_LINES) {
+    return;
+  }
+  const size_t capacity = sizeof(received->lines[0]) - 1;
+  const size_t size = length < capacity ? length : capacity;
+  memcpy(received->lines[received->count], line, size);
+  received->lines[received->count][size] = '\0';
+  received->verdicts[received->count] = verdict;
+  ++received->count;
+}
+
+/** @}*/
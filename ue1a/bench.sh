@@ -0,0 +1,76 @@
+#!/bin/sh
+# Author Markus Krainz
+# Date 2018
+# Measures lines/s and GB/s of ispalindrom per mode on synthetic corpora, and compares the
+# vectorized build against the scalar one (built with -DPALINDROM_SCALAR).
+#
+# Usage: ./bench.sh [lines]
+# The corpora are cached in $BENCH_DIR (default bench/) and only generated once.
+
+set -e
+
+LINES=${1:-2000000}
+BENCH_DIR=${BENCH_DIR:-bench}
+RUNS=${RUNS:-3}
+# the vectorized build may be at most this much slower than the scalar one
+TOLERANCE=${TOLERANCE:-1.10}
+
+mkdir -p "$BENCH_DIR"
+
+# name and gencorpus arguments of every corpus
+CORPORA="short:-l8 long:-l200 exp:-dexp,-l80 spaces:-l80,-w0.3 mixedcase:-l80,-c0.5"
+MODES="plain:- case:-i space:-s both:-i,-s"
+
+# prints the best wall time in seconds of RUNS runs of the given command
+best_time() {
+  best=""
+  run=0
+  while [ $run -lt "$RUNS" ]; do
+    start=$(date +%s.%N)
+    "$@" > /dev/null
+    end=$(date +%s.%N)
+    best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t; else print $3 }')
+    run=$((run + 1))
+  done
+  echo "$best"
+}
+
+regressions=0
+printf "%-10s %-5s %10s %12s %8s %12s %8s %7s\n" corpus mode MB "simd lines/s" "GB/s" \
+  "scalar l/s" "GB/s" speedup
+
+for corpus in $CORPORA; do
+  name=${corpus%%:*}
+  args=$(echo "${corpus#*:}" | tr ',' ' ')
+  file="$BENCH_DIR/$name-$LINES.txt"
+  if [ ! -f "$file" ]; then
+    # shellcheck disable=SC2086
+    ./gencorpus -n "$LINES" $args > "$file"
+  fi
+  bytes=$(wc -c < "$file")
+
+  for mode in $MODES; do
+    mode_name=${mode%%:*}
+    flags=$(echo "${mode#*:}" | tr ',' ' ' | sed 's/^-$//')
+
+    # shellcheck disable=SC2086
+    simd=$(best_time ./ispalindrom $flags "$file")
+    # shellcheck disable=SC2086
+    scalar=$(best_time ./ispalindrom_scalar $flags "$file")
+
+    result=$(echo "$LINES $bytes $simd $scalar $TOLERANCE" | awk '{
+      printf "%10.1f %12.0f %8.3f %12.0f %8.3f %7.2f", $2 / 1e6, $1 / $3, $2 / $3 / 1e9,
+             $1 / $4, $2 / $4 / 1e9, $4 / $3
+      if ($3 > $4 * $5) printf " REGRESSION"
+    }')
+    printf "%-10s %-5s %s\n" "$name" "$mode_name" "$result"
+    case $result in
+    *REGRESSION*) regressions=$((regressions + 1)) ;;
+    esac
+  done
+done
+
+if [ $regressions -gt 0 ]; then
+  echo "$regressions mode(s) are slower vectorized than scalar" >&2
+  exit 1
+fi
@@ -0,0 +1,314 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/** @defgroup Decompress */
+
+/** @addtogroup Decompress
+ * @brief Decompresses gzip and zstd input on a separate thread
+ *
+ * @details The compression is detected by the magic number at the start of the input, not by
+ * the file name, so compressed data on stdin works too. A thread decompresses the input into a
+ * pipe, while the reading side splits the lines coming out of the pipe like any other stream.
+ * So decompression overlaps with checking the lines, without starting an extra zcat process.
+ * gzip is always supported, zstd only if built with 'make ZSTD=yes'.
+ *
+ * @author Markus Krainz
+ * @date November 2018
+ *  @{
+ */
+
+#include "decompress.h"
+
+static const char gzip_magic[] = {'\x1f', '\x8b'};
+static const char zstd_magic[] = {'\x28', '\xb5', '\x2f', '\xfd'};
+
+/**
+ * @brief Returns true if the magic number is a prefix of data, or data is a prefix of it
+ */
+static bool matchesMagic(const char *data, size_t length, const char *magic, size_t magic_length) {
+  return memcmp(data, magic, length < magic_length ? length : magic_length) == 0;
+}
+
+/**
+ * @brief Detects the compression of an input by its first bytes
+ *
+ * @param data the start of the input
+ * @param length number of bytes in data, MAGIC_LENGTH are enough
+ * @return the compression, COMPRESSION_NONE for plain text or too short data
+ */
+Compression_t detectCompression(const char *data, size_t length) {
+  if (length >= sizeof(gzip_magic) && matchesMagic(data, length, gzip_magic, sizeof(gzip_magic))) {
+    return COMPRESSION_GZIP;
+  }
+  if (length >= sizeof(zstd_magic) && matchesMagic(data, length, zstd_magic, sizeof(zstd_magic))) {
+    return COMPRESSION_ZSTD;
+  }
+  return COMPRESSION_NONE;
+}
+
+/**
+ * @brief Returns true as long as more bytes are needed to rule out a compressed input
+ *
+ * @param data the start of the input
+ * @param length number of bytes in data
+ */
+bool mayBeCompressed(const char *data, size_t length) {
+  return length < MAGIC_LENGTH && (matchesMagic(data, length, gzip_magic, sizeof(gzip_magic)) ||
+                                   matchesMagic(data, length, zstd_magic, sizeof(zstd_magic)));
+}
+
+/**
+ * @brief Writes all bytes to a file descriptor
+ *
+ * @return 0 on success, -1 on failure and errno is set
+ */
+static int writeAll(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    const ssize_t res = write(fd, data, length);
+    if (res == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    data += res;
+    length -= res;
+  }
+  return 0;
+}
+
+/**
+ * @brief Reads the next compressed bytes, starting with the ones read for detection
+ *
+ * @return number of bytes read, 0 at the end of input, or -1 on failure with errno set
+ */
+static ssize_t readCompressed(Decompressor_t *decompressor, char *data, size_t size) {
+  if (decompressor->prefix_length > 0) {
+    const size_t length = decompressor->prefix_length;
+    memcpy(data, decompressor->prefix, length);
+    decompressor->prefix_length = 0;
+    return length;
+  }
+
+  while (true) {
+    const ssize_t res = read(decompressor->input_fd, data, size);
+    if (res == -1 && errno == EINTR) {
+      continue;
+    }
+    return res;
+  }
+}
+
+/**
+ * @brief Decompresses one or more concatenated gzip members into the pipe
+ *
+ * @return 0 on success, or the errno value of the failure
+ */
+static int inflateAll(Decompressor_t *decompressor, char *in, char *out) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // 32 lets zlib detect the gzip header
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+    return ENOMEM;
+  }
+
+  int error = 0;
+  bool in_member = true;
+  while (error == 0) {
+    if (stream.avail_in == 0) {
+      const ssize_t res = readCompressed(decompressor, in, DECOMPRESS_BUFFER_SIZE);
+      if (res == -1) {
+        error = errno;
+        break;
+      }
+      if (res == 0) {
+        // the input must not end in the middle of a member
+        error = in_member ? EBADMSG : 0;
+        break;
+      }
+      stream.next_in = (Bytef *)in;
+      stream.avail_in = res;
+    }
+
+    if (!in_member) {
+      inflateReset(&stream);
+      in_member = true;
+    }
+
+    stream.next_out = (Bytef *)out;
+    stream.avail_out = DECOMPRESS_BUFFER_SIZE;
+    const int res = inflate(&stream, Z_NO_FLUSH);
+    if (res == Z_STREAM_END) {
+      in_member = false;
+    } else if (res == Z_MEM_ERROR) {
+      error = ENOMEM;
+    } else if (res != Z_OK && res != Z_BUF_ERROR) {
+      error = EBADMSG;
+    }
+
+    if (writeAll(decompressor->pipe_fd, out, DECOMPRESS_BUFFER_SIZE - stream.avail_out) == -1) {
+      error = errno;
+    }
+  }
+
+  inflateEnd(&stream);
+  return error;
+}
+
+#ifdef HAVE_ZSTD
+/**
+ * @brief Decompresses one or more concatenated zstd frames into the pipe
+ *
+ * @return 0 on success, or the errno value of the failure
+ */
+static int zstdAll(Decompressor_t *decompressor, char *in, char *out) {
+  ZSTD_DStream *stream = ZSTD_createDStream();
+  if (stream == NULL) {
+    return ENOMEM;
+  }
+  ZSTD_initDStream(stream);
+
+  int error = 0;
+  // 0 once a frame is complete, otherwise a hint how many bytes are still missing
+  size_t remaining = 0;
+  ZSTD_inBuffer input = {in, 0, 0};
+  while (error == 0) {
+    if (input.pos == input.size) {
+      const ssize_t res = readCompressed(decompressor, in, DECOMPRESS_BUFFER_SIZE);
+      if (res == -1) {
+        error = errno;
+        break;
+      }
+      if (res == 0) {
+        error = remaining != 0 ? EBADMSG : 0;
+        break;
+      }
+      input.size = res;
+      input.pos = 0;
+    }
+
+    ZSTD_outBuffer output = {out, DECOMPRESS_BUFFER_SIZE, 0};
+    remaining = ZSTD_decompressStream(stream, &output, &input);
+    if (ZSTD_isError(remaining)) {
+      error = EBADMSG;
+    }
+
+    if (writeAll(decompressor->pipe_fd, out, output.pos) == -1) {
+      error = errno;
+    }
+  }
+
+  ZSTD_freeDStream(stream);
+  return error;
+}
+#endif
+
+/**
+ * @brief Entry point of the decompression thread
+ *
+ * @detail Closes the write end of the pipe when done, so the reader sees the end of input.
+ * @param arg the decompressor
+ * @return NULL, the result is stored in the decompressor
+ */
+static void *decompressorMain(void *arg) {
+  Decompressor_t *decompressor = arg;
+
+  // if the reader stops early, writing fails with EPIPE instead of killing the application
+  sigset_t sigpipe;
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+
+  char *in = malloc(DECOMPRESS_BUFFER_SIZE);
+  char *out = malloc(DECOMPRESS_BUFFER_SIZE);
+  if (in == NULL || out == NULL) {
+    decompressor->error = ENOMEM;
+  } else if (decompressor->compression == COMPRESSION_GZIP) {
+    decompressor->error = inflateAll(decompressor, in, out);
+  } else {
+#ifdef HAVE_ZSTD
+    decompressor->error = zstdAll(decompressor, in, out);
+#else
+    decompressor->error = ENOTSUP;
+#endif
+  }
+
+  free(in);
+  free(out);
+  close(decompressor->pipe_fd);
+  return NULL;
+}
+
+/**
+ * @brief Starts decompressing an input on a separate thread
+ *
+ * @param fd the compressed input, which is not closed by stopDecompressor()
+ * @param compression how the input is compressed
+ * @param prefix bytes that were already read from fd, at most MAGIC_LENGTH
+ * @param prefix_length number of bytes in prefix
+ * @return the decompressor, whose output_fd delivers the decompressed data, or NULL on failure
+ * and errno is set
+ */
+Decompressor_t *startDecompressor(int fd, Compression_t compression, const char *prefix,
+                                  size_t prefix_length) {
+  Decompressor_t *decompressor = malloc(sizeof(Decompressor_t));
+  if (decompressor == NULL) {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  int pipe_fds[2];
+  if (pipe(pipe_fds) == -1) {
+    free(decompressor);
+    return NULL;
+  }
+
+  decompressor->compression = compression;
+  decompressor->input_fd = fd;
+  decompressor->output_fd = pipe_fds[0];
+  decompressor->pipe_fd = pipe_fds[1];
+  memcpy(decompressor->prefix, prefix, prefix_length);
+  decompressor->prefix_length = prefix_length;
+  decompressor->error = 0;
+
+  const int res = pthread_create(&decompressor->thread, NULL, decompressorMain, decompressor);
+  if (res != 0) {
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    free(decompressor);
+    errno = res;
+    return NULL;
+  }
+  return decompressor;
+}
+
+/**
+ * @brief Waits for the decompression thread and frees the decompressor
+ *
+ * @detail Closes output_fd first, so a thread that is still writing gives up.
+ * @param decompressor the decompressor, do not reuse it afterwards
+ * @return 0 if everything was decompressed, -1 on failure and errno is set
+ */
+int stopDecompressor(Decompressor_t *decompressor) {
+  close(decompressor->output_fd);
+  pthread_join(decompressor->thread, NULL);
+
+  const int error = decompressor->error;
+  free(decompressor);
+  if (error != 0) {
+    errno = error;
+    return -1;
+  }
+  return 0;
+}
+
+/** @}*/
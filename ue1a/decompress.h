@@ -0,0 +1,34 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Longest magic number that identifies a compressed input */
+#define MAGIC_LENGTH 4
+/** Size of the compressed and of the decompressed buffer of the decompression thread */
+#define DECOMPRESS_BUFFER_SIZE (256 * 1024)
+
+typedef enum compression { COMPRESSION_NONE, COMPRESSION_GZIP, COMPRESSION_ZSTD } Compression_t;
+
+typedef struct decompressor {
+  Compression_t compression;
+  /** the compressed input */
+  int input_fd;
+  /** the decompressed data is read from here */
+  int output_fd;
+  /** write end of the pipe, only used by the thread */
+  int pipe_fd;
+  /** compressed bytes that were already read from input_fd to detect the compression */
+  char prefix[MAGIC_LENGTH];
+  size_t prefix_length;
+  pthread_t thread;
+  /** 0, or the errno value the thread failed with */
+  int error;
+} Decompressor_t;
+
+Compression_t detectCompression(const char *data, size_t length);
+bool mayBeCompressed(const char *data, size_t length);
+Decompressor_t *startDecompressor(int fd, Compression_t compression, const char *prefix,
+                                  size_t prefix_length);
+int stopDecompressor(Decompressor_t *decompressor);
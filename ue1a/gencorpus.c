@@ -0,0 +1,250 @@
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** @defgroup Gencorpus */
+
+/** @addtogroup Gencorpus
+ * @brief Generates synthetic input for benchmarking ispalindrom.
+ *
+ * @details Writes random lines to stdout. The length distribution of the lines, how many of
+ * them are palindromes, how many spaces they contain and how their case is mixed can be chosen.
+ * Palindromes stay palindromes with '-s -i', because spaces and upper case letters are only
+ * added after mirroring. Non palindromes are palindromes with one char in the middle changed,
+ * so a checker has to look at the whole line to reject them.
+ *
+ * @author Markus Krainz
+ * @date November 2018
+ *  @{
+ */
+
+typedef enum distribution { DIST_FIXED, DIST_UNIFORM, DIST_EXPONENTIAL } Distribution_t;
+
+typedef struct corpusOptions {
+  unsigned long lines;
+  unsigned long mean_length;
+  Distribution_t distribution;
+  double palindrom_ratio;
+  double whitespace_density;
+  double upper_case_ratio;
+} CorpusOptions_t;
+
+static void printUsage(char *name);
+static double parseRatio(char *name, char option, const char *arg);
+static unsigned long parseNumber(char *name, char option, const char *arg);
+static size_t lineLength(const CorpusOptions_t *options);
+static double randomUnit(void);
+
+int main(int argc, char *argv[]) {
+  CorpusOptions_t options = {.lines = 1000000,
+                             .mean_length = 80,
+                             .distribution = DIST_UNIFORM,
+                             .palindrom_ratio = 0.5,
+                             .whitespace_density = 0.0,
+                             .upper_case_ratio = 0.0};
+  unsigned long seed = 1;
+
+  // parse arguments
+  {
+    const char *optstring = "n:l:d:p:w:c:r:";
+    int c;
+
+    // getopt returns -1 if there is no more character
+    // Or it returns '?' in case of unknown option or missing option argument
+    while ((c = getopt(argc, argv, optstring)) != -1) {
+      switch (c) {
+      case 'n': {
+        options.lines = parseNumber(argv[0], c, optarg);
+      } break;
+      case 'l': {
+        options.mean_length = parseNumber(argv[0], c, optarg);
+      } break;
+      case 'd': {
+        if (strcmp(optarg, "fixed") == 0) {
+          options.distribution = DIST_FIXED;
+        } else if (strcmp(optarg, "uniform") == 0) {
+          options.distribution = DIST_UNIFORM;
+        } else if (strcmp(optarg, "exp") == 0) {
+          options.distribution = DIST_EXPONENTIAL;
+        } else {
+          fprintf(stderr, "[%s, %s, %d] ERROR unknown distribution %s \n", argv[0], __FILE__,
+                  __LINE__, optarg);
+          printUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      } break;
+      case 'p': {
+        options.palindrom_ratio = parseRatio(argv[0], c, optarg);
+      } break;
+      case 'w': {
+        options.whitespace_density = parseRatio(argv[0], c, optarg);
+      } break;
+      case 'c': {
+        options.upper_case_ratio = parseRatio(argv[0], c, optarg);
+      } break;
+      case 'r': {
+        seed = parseNumber(argv[0], c, optarg);
+      } break;
+      case '?': {
+        fprintf(stderr, "[%s, %s, %d] ERROR unknown option or missing argument \n", argv[0],
+                __FILE__, __LINE__);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+      } break;
+      default:
+        assert(0 && "We should never reach this if the optstring is valid");
+      }
+    }
+
+    if (optind != argc) {
+      fprintf(stderr, "[%s, %s, %d] ERROR no positional arguments expected \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  srandom(seed);
+
+  size_t capacity = 2 * options.mean_length + 2;
+  char *line = malloc(capacity);
+  if (line == NULL) {
+    fprintf(stderr, "FATAL ERROR out of memory");
+    exit(EXIT_FAILURE);
+  }
+
+  for (unsigned long n = 0; n < options.lines; ++n) {
+    const size_t letters = lineLength(&options);
+
+    // a line can at most double by adding spaces, plus the newline
+    if (2 * letters + 1 > capacity) {
+      capacity = 2 * letters + 1;
+      line = realloc(line, capacity);
+      if (line == NULL) {
+        fprintf(stderr, "FATAL ERROR out of memory");
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    // mirror random lower case letters, the second half starts at the back of the buffer
+    char *const letters_start = line + capacity - letters;
+    for (size_t i = 0; i < letters / 2; ++i) {
+      letters_start[i] = 'a' + random() % 26;
+      letters_start[letters - 1 - i] = letters_start[i];
+    }
+    if (letters % 2 == 1) {
+      letters_start[letters / 2] = 'a' + random() % 26;
+    }
+    if (letters >= 2 && randomUnit() >= options.palindrom_ratio) {
+      // breaks the palindrome as late as possible for a checker working from both ends
+      char *middle = &letters_start[letters / 2 - 1];
+      *middle = *middle == 'z' ? 'a' : *middle + 1;
+    }
+
+    // copy the letters to the front, mixing in spaces and upper case letters
+    size_t length = 0;
+    for (size_t i = 0; i < letters; ++i) {
+      while (randomUnit() < options.whitespace_density && length < capacity - letters + i) {
+        line[length++] = ' ';
+      }
+      char c = letters_start[i];
+      if (randomUnit() < options.upper_case_ratio) {
+        c += 'A' - 'a';
+      }
+      line[length++] = c;
+    }
+
+    fwrite(line, 1, length, stdout);
+    fputc('\n', stdout);
+  }
+
+  free(line);
+  if (fflush(stdout) != 0) {
+    fprintf(stderr, "[%s, %s, %d] ERROR writing failed: %s\n", argv[0], __FILE__, __LINE__,
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Prints help including arguments of this program to stderr.
+ *
+ * @param name c_string of the name of the executable
+ */
+void printUsage(char *name) {
+  fprintf(stderr, "\nUsage:\n\n");
+  fprintf(stderr, "%s [-n lines] [-l length] [-d fixed|uniform|exp] [-p ratio] [-w density] "
+                  "[-c ratio] [-r seed]\n",
+          name);
+  fprintf(stderr, "\t-n number of lines, default 1000000\n");
+  fprintf(stderr, "\t-l mean number of letters per line, default 80\n");
+  fprintf(stderr, "\t-d distribution of the line lengths, default uniform between 0 and 2 * "
+                  "length\n");
+  fprintf(stderr, "\t-p ratio of palindromes between 0 and 1, default 0.5\n");
+  fprintf(stderr, "\t-w probability of a space in front of each letter, default 0\n");
+  fprintf(stderr, "\t-c ratio of upper case letters, default 0\n");
+  fprintf(stderr, "\t-r seed of the random number generator, default 1\n");
+}
+
+/**
+ * @brief Parses a number between 0 and 1 or terminates the application.
+ */
+double parseRatio(char *name, char option, const char *arg) {
+  char *end_pointer;
+  errno = 0;
+  const double ratio = strtod(arg, &end_pointer);
+  if (errno != 0 || *end_pointer != '\0' || !(ratio >= 0 && ratio <= 1)) {
+    fprintf(stderr, "[%s, %s, %d] ERROR '-%c' expects a number between 0 and 1 \n", name,
+            __FILE__, __LINE__, option);
+    printUsage(name);
+    exit(EXIT_FAILURE);
+  }
+  return ratio;
+}
+
+/**
+ * @brief Parses a non negative integer or terminates the application.
+ */
+unsigned long parseNumber(char *name, char option, const char *arg) {
+  char *end_pointer;
+  errno = 0;
+  const unsigned long number = strtoul(arg, &end_pointer, 10);
+  if (errno != 0 || *end_pointer != '\0' || arg[0] == '-') {
+    fprintf(stderr, "[%s, %s, %d] ERROR '-%c' expects a number \n", name, __FILE__, __LINE__,
+            option);
+    printUsage(name);
+    exit(EXIT_FAILURE);
+  }
+  return number;
+}
+
+/**
+ * @brief Draws the number of letters of the next line.
+ */
+size_t lineLength(const CorpusOptions_t *options) {
+  switch (options->distribution) {
+  case DIST_FIXED:
+    return options->mean_length;
+  case DIST_UNIFORM:
+    return random() % (2 * options->mean_length + 1);
+  case DIST_EXPONENTIAL:
+    return (size_t)(-log(1.0 - randomUnit()) * options->mean_length);
+  }
+  assert(0 && "We should never reach this with a valid distribution");
+  return 0;
+}
+
+/**
+ * @brief Returns a random number in [0, 1)
+ */
+double randomUnit(void) {
+  return random() / ((double)RAND_MAX + 1);
+}
+
+/** @}*/
@@ -1,6 +1,9 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -13,7 +16,8 @@
 /** @addtogroup Palindrom
  * @brief Checks if lines are palindromes.
  * 
- * @details Can read one or more files, or stdin line by line.
+ * @details Can read one or more files, or stdin line by line. gzip and zstd compressed input
+ * is decompressed transparently.
  * Checks if each line is a palindrom. May ignore whitespaces or
  * not differentiate between lower and upper cases letters.
  * 
@@ -23,19 +27,117 @@
  */
 
 #include "ispalindrom.h"
+#include "tools.h"
+#include "utf8.h"
 
-static int8_t isPalindrom(char *c_string, int8_t ignore_case, int8_t ignore_whitespace);
-static void handleFile(FILE *input_file, FILE *out_file, int8_t ignore_case,
-                       int8_t ignore_whitespace);
+/** Blocks smaller than this are never split up between threads */
+#define MIN_CHUNK_SIZE (256 * 1024)
+/** Number of chunks per worker thread a block is split into, to balance the load */
+#define CHUNKS_PER_THREAD 4
+
+/** Passed as first line number if line numbers are only appended in binary, relative to the
+ * beginning of the chunk, because the number of lines in front of the chunk is not known yet */
+#define DEFERRED_LINE_NUMBERS 0
+
+typedef enum outputFormat {
+  /** every line followed by "is (not) a palindrom" */
+  FORMAT_TEXT,
+  /** 1 or 0 for every line */
+  FORMAT_FLAG,
+  /** only the numbers of the lines that are palindromes */
+  FORMAT_LINENO
+} OutputFormat_t;
+
+typedef enum searchMode {
+  /** checks if whole lines are palindromes */
+  SEARCH_NONE,
+  /** finds the longest palindromic substring of every line */
+  SEARCH_LONGEST,
+  /** finds all maximal palindromic substrings with a minimum length */
+  SEARCH_ALL
+} SearchMode_t;
+
+typedef struct options {
+  /** how lines are compared, PALINDROM_* flags of the library */
+  unsigned flags;
+  OutputFormat_t format;
+  SearchMode_t search;
+  /** shortest palindrome reported by SEARCH_ALL, counted in normalized characters */
+  size_t min_length;
+  /** number of verdicts every thread caches, 0 to check every line */
+  size_t cache_entries;
+  /** what is written behind a line, indexed by the result of palindromCheck */
+  const char *suffix[2];
+  size_t suffix_length[2];
+} Options_t;
+
+/** Memory every thread reuses for all its lines, so lines need no allocations */
+typedef struct workspace {
+  /** verdicts of recently seen lines, only used if use_cache */
+  Cache_t cache;
+  bool use_cache;
+  /** normalized characters: bytes or code points, lower case if ignore_case */
+  uint32_t *points;
+  size_t point_capacity;
+  /** unit k of the line consists of points[first_point[k]..first_point[k + 1]) */
+  size_t *first_point;
+  /** unit k of the line was line[begin[k]..end[k]) before normalization */
+  size_t *begin;
+  size_t *end;
+  size_t unit_capacity;
+  /** palindrome radius around each of the 2 * units + 1 centers */
+  size_t *radius;
+} Workspace_t;
+
+typedef struct chunk {
+  const char *start;
+  size_t length;
+  size_t lines;
+  Buffer_t out;
+  bool done;
+} Chunk_t;
+
+typedef struct workers {
+  const Options_t *options;
+  pthread_t *threads;
+  size_t thread_count;
+  pthread_mutex_t mutex;
+  pthread_cond_t work_available;
+  pthread_cond_t chunk_done;
+  Chunk_t *chunks;
+  size_t chunk_count;
+  size_t next_chunk;
+  bool shutdown;
+  /** cache statistics of the threads that have stopped */
+  size_t cache_lookups;
+  size_t cache_hits;
+} Workers_t;
+
+static void searchPalindroms(const Options_t *options, const char *line, size_t length,
+                             Workspace_t *workspace, Buffer_t *out);
+static void initWorkspace(Workspace_t *workspace, const Options_t *options);
+static void freeWorkspace(Workspace_t *workspace);
+static size_t handleLines(const Options_t *options, const char *start, size_t length,
+                          size_t first_line, Workspace_t *workspace, Buffer_t *out);
+static void handleFile(int input_fd, Buffer_t *out, const Options_t *options, Workers_t *workers,
+                       Workspace_t *workspace);
+static void startWorkers(Workers_t *workers, const Options_t *options, size_t thread_count);
+static void stopWorkers(Workers_t *workers);
+static void *workerMain(void *arg);
 static void printUsage(char *name);
 
 int main(int argc, char *argv[]) {
 
   // parse arguments
   char *outfile_arg = NULL;
-  int ignorewhitespace_count = 0, ignorecase_count = 0, o_count = 0;
+  char *threads_arg = NULL;
+  char *format_arg = NULL;
+  char *min_length_arg = NULL;
+  char *cache_arg = NULL;
+  int ignorewhitespace_count = 0, ignorecase_count = 0, o_count = 0, j_count = 0, f_count = 0;
+  int utf8_count = 0, graphemes_count = 0, longest_count = 0, m_count = 0, c_count = 0;
   {
-    const char *optstring = "sio:";
+    const char *optstring = "siuglm:c:o:j:f:";
     int c;
 
     // getopt returns -1 if there is no more character
@@ -48,10 +150,35 @@ int main(int argc, char *argv[]) {
       case 'i': {
         ++ignorecase_count;
       } break;
+      case 'u': {
+        ++utf8_count;
+      } break;
+      case 'g': {
+        ++graphemes_count;
+      } break;
+      case 'l': {
+        ++longest_count;
+      } break;
+      case 'm': {
+        ++m_count;
+        min_length_arg = optarg;
+      } break;
+      case 'c': {
+        ++c_count;
+        cache_arg = optarg;
+      } break;
       case 'o': {
         ++o_count;
         outfile_arg = optarg;
       } break;
+      case 'j': {
+        ++j_count;
+        threads_arg = optarg;
+      } break;
+      case 'f': {
+        ++f_count;
+        format_arg = optarg;
+      } break;
       case '?': {
         fprintf(stderr, "[%s, %s, %d] ERROR unknown option or missing argument \n", argv[0],
                 __FILE__, __LINE__);
@@ -77,49 +204,193 @@ int main(int argc, char *argv[]) {
       exit(EXIT_FAILURE);
     }
 
+    if (utf8_count > 1 || graphemes_count > 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR Provide at most one '-u' and '-g' argument \n",
+              argv[0], __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+
+    if (longest_count + m_count > 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR Provide at most one '-l' or '-m' argument \n",
+              argv[0], __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+
+    if (c_count > 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR Provide at most one '-c' argument \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+
     if (o_count > 1) {
       fprintf(stderr, "[%s, %s, %d]  ERROR Provide at most one '-o' argument \n", argv[0],
               __FILE__, __LINE__);
       printUsage(argv[0]);
       exit(EXIT_FAILURE);
     }
+
+    if (j_count > 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR Provide at most one '-j' argument \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+
+    if (f_count > 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR Provide at most one '-f' argument \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
   }
 
-  FILE *out_file = NULL;
+  Options_t options = {.flags = (ignorecase_count > 0 ? PALINDROM_IGNORE_CASE : 0) |
+                                (ignorewhitespace_count > 0 ? PALINDROM_IGNORE_WHITESPACE : 0) |
+                                (utf8_count > 0 ? PALINDROM_UTF8 : 0) |
+                                (graphemes_count > 0 ? PALINDROM_UTF8 | PALINDROM_GRAPHEMES : 0),
+                       .format = FORMAT_TEXT,
+                       .search = SEARCH_NONE,
+                       .cache_entries = 0,
+                       .suffix = {" is not a palindrom \n", " is a palindrom \n"}};
+  if (f_count > 0) {
+    if (strcmp(format_arg, "flag") == 0) {
+      options.format = FORMAT_FLAG;
+      options.suffix[0] = "0\n";
+      options.suffix[1] = "1\n";
+    } else if (strcmp(format_arg, "lineno") == 0) {
+      options.format = FORMAT_LINENO;
+    } else if (strcmp(format_arg, "text") != 0) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR unknown output format %s \n", argv[0], __FILE__,
+              __LINE__, format_arg);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (longest_count > 0) {
+    options.search = SEARCH_LONGEST;
+  } else if (m_count > 0) {
+    char *end_pointer;
+    errno = 0;
+    const long min_length = strtol(min_length_arg, &end_pointer, 10);
+    if (errno != 0 || *end_pointer != '\0' || min_length < 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR '-m' expects a length of at least 1 \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    options.search = SEARCH_ALL;
+    options.min_length = min_length;
+  }
+  if (c_count > 0) {
+    char *end_pointer;
+    errno = 0;
+    const long cache_entries = strtol(cache_arg, &end_pointer, 10);
+    if (errno != 0 || *end_pointer != '\0' || cache_entries < 1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR '-c' expects a number of entries \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    options.cache_entries = cache_entries;
+  }
+  if (options.search != SEARCH_NONE && options.format == FORMAT_LINENO) {
+    fprintf(stderr, "[%s, %s, %d]  ERROR '-f lineno' cannot be combined with '-l' or '-m' \n",
+            argv[0], __FILE__, __LINE__);
+    printUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  if (options.search != SEARCH_NONE && options.cache_entries > 0) {
+    // the cache holds verdicts of whole lines, the substrings are searched in every line
+    fprintf(stderr, "[%s, %s, %d]  ERROR '-c' cannot be combined with '-l' or '-m' \n", argv[0],
+            __FILE__, __LINE__);
+    printUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < 2; ++i) {
+    options.suffix_length[i] = options.suffix[i] == NULL ? 0 : strlen(options.suffix[i]);
+  }
+
+  long thread_count = 1;
+  if (j_count > 0) {
+    char *end_pointer;
+    errno = 0;
+    thread_count = strtol(threads_arg, &end_pointer, 10);
+    if (errno != 0 || *end_pointer != '\0' || thread_count < 0) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR '-j' expects a number of threads \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if (thread_count == 0) {
+      thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+  }
+
+  int out_fd = STDOUT_FILENO;
 
   if (o_count > 0) {
-    out_file = fopen(outfile_arg, "w");
-    if (out_file == NULL) {
-      fprintf(stderr, "[%s, %s, %d]  ERROR fopen failed on outfile: %s\n", argv[0], __FILE__,
+    out_fd = open(outfile_arg, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (out_fd == -1) {
+      fprintf(stderr, "[%s, %s, %d]  ERROR open failed on outfile: %s\n", argv[0], __FILE__,
               __LINE__, strerror(errno));
       exit(EXIT_FAILURE);
     }
   }
 
+  Buffer_t out;
+  initBuffer(&out, out_fd);
+  Workspace_t workspace;
+  initWorkspace(&workspace, &options);
+
+  Workers_t workers;
+  if (thread_count > 1) {
+    startWorkers(&workers, &options, thread_count);
+  }
+  Workers_t *const workers_or_null = thread_count > 1 ? &workers : NULL;
+
   const int number_of_file_args = argc - optind;
 
   if (number_of_file_args == 0) {
-    handleFile(NULL, out_file, ignorecase_count, ignorewhitespace_count);
+    handleFile(STDIN_FILENO, &out, &options, workers_or_null, &workspace);
   } else {
     for (int i = 0; i < number_of_file_args; ++i) {
-      FILE *input_file = fopen(argv[optind + i], "r");
+      const int input_fd = open(argv[optind + i], O_RDONLY);
 
-      if (input_file == NULL) {
-        if (out_file != NULL) {
-          fclose(out_file);
-        }
-        fprintf(stderr, "[%s,%s, %d] ERROR fopen failed,: %s\n", argv[0], __FILE__, __LINE__,
+      if (input_fd == -1) {
+        flushBuffer(&out);
+        fprintf(stderr, "[%s,%s, %d] ERROR open failed,: %s\n", argv[0], __FILE__, __LINE__,
                 strerror(errno));
         exit(EXIT_FAILURE);
       }
 
-      handleFile(input_file, out_file, ignorecase_count, ignorewhitespace_count);
-      fclose(input_file);
+      handleFile(input_fd, &out, &options, workers_or_null, &workspace);
+      close(input_fd);
     }
   }
 
-  if (out_file != NULL) {
-    fclose(out_file);
+  if (thread_count > 1) {
+    stopWorkers(&workers);
+  }
+
+  if (workspace.use_cache) {
+    size_t lookups = workspace.cache.lookups;
+    size_t hits = workspace.cache.hits;
+    if (thread_count > 1) {
+      lookups += workers.cache_lookups;
+      hits += workers.cache_hits;
+    }
+    fprintf(stderr, "cache: %zu hits of %zu lookups (%.1f%%)\n", hits, lookups,
+            lookups == 0 ? 0.0 : 100.0 * hits / lookups);
+  }
+
+  freeWorkspace(&workspace);
+  flushBuffer(&out);
+  freeBuffer(&out);
+  if (out_fd != STDOUT_FILENO) {
+    close(out_fd);
   }
 
   return EXIT_SUCCESS;
@@ -132,119 +403,635 @@ int main(int argc, char *argv[]) {
  */
 void printUsage(char *name) {
   fprintf(stderr, "\nUsage:\n\n");
-  fprintf(stderr, "%s [-s] [-i] [-o outfile] [file...]\n", name);
+  fprintf(stderr,
+          "%s [-s] [-i] [-u] [-g] [-l | -m length] [-c entries] [-o outfile] "
+          "[-f text|flag|lineno] [-j threads] [file...]\n",
+          name);
   fprintf(stderr, "\t-o output is written to the specified file\n");
+  fprintf(stderr, "\t-f output every line with its result (text, the default), only 1 or 0 for\n"
+                  "\t   every line (flag), or only the numbers of palindromic lines (lineno)\n");
+  fprintf(stderr, "\t-j number of threads checking lines in parallel, 0 for one per core\n");
   fprintf(stderr, "\t-s causes program to ignore whitespaces\n");
   fprintf(stderr, "\t-i program does not differentiate between lower and upper cases letters.\n");
+  fprintf(stderr, "\t-u lines are UTF-8 and compared by code points, -i folds Unicode case\n");
+  fprintf(stderr, "\t-g like -u, but compares grapheme clusters, e.g. letters with accents\n");
+  fprintf(stderr, "\t-c caches the verdicts of up to this many lines per thread, which pays\n"
+                  "\t   off for repetitive input. Prints the hit rate to stderr at the end.\n"
+                  "\t   Not with -l or -m, which search every line anyway\n");
+  fprintf(stderr, "\t-l finds the longest palindromic substring of every line\n");
+  fprintf(stderr, "\t-m finds all maximal palindromic substrings of at least length characters\n"
+                  "\t   -l and -m print byte offset:length, -f flag prints only those\n");
+  fprintf(stderr, "\tgzip and zstd compressed files and stdin are decompressed on the fly\n");
 }
 
 /**
- * @brief Checks one input file's lines for being a palindrome.
+ * @brief Checks a line, or takes the verdict from the cache if the same line was seen before.
  *
- * @detail The file is read line by line. Memory is allocated dynamicaly internally.
- * Output is written to *out_file or stdout.
+ * @detail Lines are identified by hash and length only. A collision of two lines with the same
+ * length and 64 bit hash while both are in the cache is astronomically unlikely.
+ * @param options how lines are compared
+ * @param line the line
+ * @param length number of bytes in line
+ * @param workspace contains the cache of the calling thread
+ * @return 1 if line is a palindrome, 0 otherwise
+ */
+static inline int8_t checkLine(const Options_t *options, const char *line, size_t length,
+                               Workspace_t *workspace) {
+  if (!workspace->use_cache || length < CACHE_MIN_LENGTH) {
+    return palindromCheck(line, length, options->flags);
+  }
+
+  const uint64_t hash = hashLine(line, length);
+  int8_t verdict = lookupCache(&workspace->cache, hash, length);
+  if (verdict == -1) {
+    verdict = palindromCheck(line, length, options->flags);
+    insertCache(&workspace->cache, hash, length, verdict);
+  }
+  return verdict;
+}
+
+/**
+ * @brief Appends a number in decimal to a buffer.
  *
- * @param input_file filestream to be read. Must be opened and valid. This parameter may be NULL -
- * in this case this function reads from stdin
- * @param out_file filestream to write result to. Must be opened and valid. If this is NULL then
- * this funtion outputs to stdout
- * @param ignore_case if != 0 then then upper/lower-case is ignored when processing
- * palindrome
- * @param ignore_whitespace if != 0 then then all whitespace (not including special
- * characters like '\t') is ignored when processing palindrome
+ * @param out the buffer
+ * @param number the number
  */
-void handleFile(FILE *input_file, FILE *out_file, int8_t ignore_case, int8_t ignore_whitespace) {
+static void appendNumber(Buffer_t *out, size_t number) {
+  char digits[24];
+  char *pos = digits + sizeof(digits);
+  do {
+    *--pos = '0' + number % 10;
+    number /= 10;
+  } while (number > 0);
+  appendBuffer(out, pos, digits + sizeof(digits) - pos);
+}
+
+/**
+ * @brief Appends a line number and a newline to a buffer.
+ *
+ * @param out the buffer
+ * @param number the line number
+ */
+static void appendLineNumber(Buffer_t *out, size_t number) {
+  appendNumber(out, number);
+  appendBuffer(out, "\n", 1);
+}
+
+/**
+ * @brief Checks all lines of a block and appends the results to a buffer.
+ *
+ * @param options how lines are compared and the results formatted
+ * @param start first char of the first line
+ * @param length number of chars in all lines. The last line might not be terminated by '\n'.
+ * @param first_line number of the first line, or DEFERRED_LINE_NUMBERS
+ * @param workspace memory for searching palindromic substrings
+ * @param out buffer the results are appended to
+ * @return the number of lines
+ */
+size_t handleLines(const Options_t *options, const char *start, size_t length, size_t first_line,
+                   Workspace_t *workspace, Buffer_t *out) {
+  const char *line = start;
+  const char *const end = start + length;
+  size_t line_index = 0;
+
+  while (line < end) {
+    const char *newline = memchr(line, '\n', end - line);
+    const size_t line_length = (newline == NULL ? end : newline) - line;
+
+    if (options->search != SEARCH_NONE) {
+      searchPalindroms(options, line, line_length, workspace, out);
+    } else {
+      // check if string is palindrome and print the result
+      const uint8_t is_palindrom = checkLine(options, line, line_length, workspace);
+      if (options->format == FORMAT_TEXT) {
+        appendBuffer(out, line, line_length);
+      }
+      if (options->format == FORMAT_LINENO) {
+        if (is_palindrom && first_line == DEFERRED_LINE_NUMBERS) {
+          appendBuffer(out, (const char *)&line_index, sizeof(line_index));
+        } else if (is_palindrom) {
+          appendLineNumber(out, first_line + line_index);
+        }
+      } else {
+        appendBuffer(out, options->suffix[is_palindrom], options->suffix_length[is_palindrom]);
+      }
+    }
+
+    line += line_length + 1;
+    ++line_index;
+  }
+
+  return line_index;
+}
+
+/**
+ * @brief Splits a block into newline aligned chunks and lets the workers check them.
+ *
+ * @detail The results of the chunks are written in their original order as soon as they are
+ * done, while the workers already continue with the following chunks. Chunks that are done at
+ * the same time are written with one writev.
+ * @param workers running worker threads, which are idle when this function returns
+ * @param block the block of whole lines
+ * @param block_size number of chars in block
+ * @param first_line number of the first line in block
+ * @param workspace memory for searching palindromic substrings in the calling thread
+ * @param out where the results are written to
+ * @return the number of lines in block
+ */
+static size_t handleBlockParallel(Workers_t *workers, const char *block, size_t block_size,
+                                  size_t first_line, Workspace_t *workspace, Buffer_t *out) {
+  size_t chunk_count = workers->thread_count * CHUNKS_PER_THREAD;
+  if (block_size / MIN_CHUNK_SIZE < chunk_count) {
+    chunk_count = block_size / MIN_CHUNK_SIZE;
+  }
+
+  if (chunk_count <= 1) {
+    // not worth waking up the workers
+    return handleLines(workers->options, block, block_size, first_line, workspace, out);
+  }
+
+  pthread_mutex_lock(&workers->mutex);
+  const char *chunk_start = block;
+  const char *const block_end = block + block_size;
+  size_t count = 0;
+  for (size_t i = 1; i <= chunk_count && chunk_start < block_end; ++i) {
+    // chunks end behind the first newline after their share of the block
+    const char *chunk_end = block_end;
+    if (i < chunk_count) {
+      const char *target = block + block_size / chunk_count * i;
+      if (target < chunk_start) {
+        target = chunk_start;
+      }
+      const char *newline = memchr(target, '\n', block_end - target);
+      if (newline != NULL) {
+        chunk_end = newline + 1;
+      }
+    }
+
+    workers->chunks[count].start = chunk_start;
+    workers->chunks[count].length = chunk_end - chunk_start;
+    workers->chunks[count].done = false;
+    ++count;
+    chunk_start = chunk_end;
+  }
+  workers->chunk_count = count;
+  workers->next_chunk = 0;
+  pthread_cond_broadcast(&workers->work_available);
+  pthread_mutex_unlock(&workers->mutex);
+
+  size_t line_number = first_line;
+  for (size_t i = 0; i < count;) {
+    pthread_mutex_lock(&workers->mutex);
+    while (!workers->chunks[i].done) {
+      pthread_cond_wait(&workers->chunk_done, &workers->mutex);
+    }
+    // collect all following chunks that are done as well
+    size_t done = 1;
+    while (i + done < count && done < MAX_WRITEV_BUFFERS && workers->chunks[i + done].done) {
+      ++done;
+    }
+    pthread_mutex_unlock(&workers->mutex);
 
-  // note: linebuffer_size is not const, as getline might modify it when it
-  // needs to resize the buffer
-  size_t linebuffer_size = 2;
-  char *line = malloc(linebuffer_size);
+    if (workers->options->format == FORMAT_LINENO) {
+      // the workers could not know the line numbers, so they are only added now
+      for (size_t k = i; k < i + done; ++k) {
+        const Chunk_t *chunk = &workers->chunks[k];
+        for (size_t pos = 0; pos < chunk->out.size; pos += sizeof(size_t)) {
+          size_t line_index;
+          memcpy(&line_index, chunk->out.data + pos, sizeof(line_index));
+          appendLineNumber(out, line_number + line_index);
+        }
+        line_number += chunk->lines;
+      }
+    } else {
+      Buffer_t *buffers[MAX_WRITEV_BUFFERS + 1];
+      buffers[0] = out;
+      for (size_t k = 0; k < done; ++k) {
+        buffers[k + 1] = &workers->chunks[i + k].out;
+        line_number += workers->chunks[i + k].lines;
+      }
+      writevBuffers(out->fd, buffers, done + 1);
+      out->size = 0;
+    }
+    i += done;
+  }
+
+  return line_number - first_line;
+}
+
+/**
+ * @brief Checks one input file's lines for being a palindrome.
+ *
+ * @detail Regular files are memory mapped, everything else is read in big blocks. gzip and zstd
+ * compressed input is decompressed on a separate thread. Lines are found with memchr and checked
+ * in place without copying them.
+ *
+ * @param input_fd file descriptor to be read. Must be opened and valid.
+ * @param out buffer the results are written to
+ * @param options how lines are compared and the results formatted
+ * @param workers worker threads to split the lines between, or NULL to check them sequentially
+ * @param workspace memory for searching palindromic substrings in the calling thread
+ */
+void handleFile(int input_fd, Buffer_t *out, const Options_t *options, Workers_t *workers,
+                Workspace_t *workspace) {
+  Input_t input;
+  if (openInput(&input, input_fd) == -1) {
+    flushBuffer(out);
+    fprintf(stderr, "ERROR opening input failed: %s\n", strerror(errno));
+    exit(EXIT_FAILURE);
+  }
 
-  if (line == NULL) {
-    if (input_file != NULL) {
-      fclose(input_file);
+  size_t line_number = 1;
+  const char *block;
+  ssize_t block_size;
+  while ((block_size = nextBlock(&input, &block)) > 0) {
+    if (workers == NULL) {
+      line_number += handleLines(options, block, block_size, line_number, workspace, out);
+    } else {
+      line_number +=
+          handleBlockParallel(workers, block, block_size, line_number, workspace, out);
     }
-    if (out_file != NULL) {
-      fclose(out_file);
+    if (input.interactive) {
+      // answer the user right away
+      flushBuffer(out);
     }
+  }
+
+  if (block_size == -1) {
+    flushBuffer(out);
+    fprintf(stderr, "ERROR reading input failed: %s\n", strerror(errno));
+    closeInput(&input);
+    exit(EXIT_FAILURE);
+  }
+
+  closeInput(&input);
+}
 
+/**
+ * @brief Starts worker threads that wait for chunks to check.
+ *
+ * @detail Terminates the application if the threads cannot be created.
+ * @param workers the workers to be initialized
+ * @param options how lines are compared, must stay valid until stopWorkers()
+ * @param thread_count number of threads to start
+ */
+void startWorkers(Workers_t *workers, const Options_t *options, size_t thread_count) {
+  workers->options = options;
+  workers->thread_count = thread_count;
+  workers->chunk_count = 0;
+  workers->next_chunk = 0;
+  workers->shutdown = false;
+  workers->cache_lookups = 0;
+  workers->cache_hits = 0;
+  pthread_mutex_init(&workers->mutex, NULL);
+  pthread_cond_init(&workers->work_available, NULL);
+  pthread_cond_init(&workers->chunk_done, NULL);
+
+  workers->chunks = malloc(sizeof(Chunk_t) * thread_count * CHUNKS_PER_THREAD);
+  workers->threads = malloc(sizeof(pthread_t) * thread_count);
+  if (workers->chunks == NULL || workers->threads == NULL) {
     fprintf(stderr, "FATAL ERROR out of memory");
     exit(EXIT_FAILURE);
   }
+  for (size_t i = 0; i < thread_count * CHUNKS_PER_THREAD; ++i) {
+    initBuffer(&workers->chunks[i].out, -1);
+  }
 
-  // getline() returns -1 on failure to read a line (including EOF).
-  ssize_t characters_read;
-  while ((characters_read =
-              getline(&line, &linebuffer_size, input_file == NULL ? stdin : input_file)) != -1) {
-    // remove tailing newline (which is also the first occurance of '\n' because
-    // we read line by line)
-    {
-      char *pos = strchr(line, '\n');
-      *pos = '\0';
+  for (size_t i = 0; i < thread_count; ++i) {
+    if (pthread_create(&workers->threads[i], NULL, workerMain, workers) != 0) {
+      fprintf(stderr, "FATAL ERROR cannot create thread");
+      exit(EXIT_FAILURE);
     }
+  }
+}
+
+/**
+ * @brief Stops and joins the worker threads and frees their resources.
+ *
+ * @param workers the workers, which must be idle
+ */
+void stopWorkers(Workers_t *workers) {
+  pthread_mutex_lock(&workers->mutex);
+  workers->shutdown = true;
+  pthread_cond_broadcast(&workers->work_available);
+  pthread_mutex_unlock(&workers->mutex);
+
+  for (size_t i = 0; i < workers->thread_count; ++i) {
+    pthread_join(workers->threads[i], NULL);
+  }
 
-    // check if string is palindrome and print the result
-    {
-      const uint8_t is_palindrom = isPalindrom(line, ignore_case, ignore_whitespace);
-      fprintf(out_file == NULL ? stdout : out_file, "%s %s \n", line,
-              is_palindrom ? "is a palindrom" : "is not a palindrom");
+  for (size_t i = 0; i < workers->thread_count * CHUNKS_PER_THREAD; ++i) {
+    freeBuffer(&workers->chunks[i].out);
+  }
+  free(workers->chunks);
+  free(workers->threads);
+  pthread_cond_destroy(&workers->chunk_done);
+  pthread_cond_destroy(&workers->work_available);
+  pthread_mutex_destroy(&workers->mutex);
+}
+
+/**
+ * @brief Main function of a worker thread. Checks chunks until it is shut down.
+ *
+ * @param arg the Workers_t this thread belongs to
+ * @return always NULL
+ */
+void *workerMain(void *arg) {
+  Workers_t *workers = arg;
+  Workspace_t workspace;
+  initWorkspace(&workspace, workers->options);
+
+  pthread_mutex_lock(&workers->mutex);
+  while (true) {
+    while (!workers->shutdown && workers->next_chunk == workers->chunk_count) {
+      pthread_cond_wait(&workers->work_available, &workers->mutex);
+    }
+    if (workers->shutdown) {
+      break;
     }
+    Chunk_t *chunk = &workers->chunks[workers->next_chunk++];
+    pthread_mutex_unlock(&workers->mutex);
+
+    chunk->out.size = 0;
+    chunk->lines = handleLines(workers->options, chunk->start, chunk->length,
+                               DEFERRED_LINE_NUMBERS, &workspace, &chunk->out);
+
+    pthread_mutex_lock(&workers->mutex);
+    chunk->done = true;
+    pthread_cond_broadcast(&workers->chunk_done);
   }
+  if (workspace.use_cache) {
+    workers->cache_lookups += workspace.cache.lookups;
+    workers->cache_hits += workspace.cache.hits;
+  }
+  pthread_mutex_unlock(&workers->mutex);
 
-  free(line);
+  freeWorkspace(&workspace);
+  return NULL;
 }
 
 /**
- * @brief returns != 0 if the string is a palindrom
+ * @brief Initializes a workspace
  *
- * @detail May skip spaces and match different cases as equal depending on parameters.
+ * @detail Only the cache is allocated right away, the rest when the first line needs it.
+ * @param workspace the workspace to be initialized
+ * @param options tell if and how big a cache is needed
+ */
+void initWorkspace(Workspace_t *workspace, const Options_t *options) {
+  memset(workspace, 0, sizeof(*workspace));
+  workspace->use_cache = options->cache_entries > 0 && options->search == SEARCH_NONE;
+  if (workspace->use_cache) {
+    initCache(&workspace->cache, options->cache_entries);
+  }
+}
+
+/**
+ * @brief Frees the memory of a workspace
  *
- * @param c_string pointer to '\0' terminated char sequence which will be tested
- * for being a palindrom
- * @param ignore_case if != 0 then then upper/lower-case is ignored when processing
- * palindrome
- * @param ignore_whitespace if != 0 then then all whitespace (not including special
- * characters like '\t') is ignored when processing palindrome
- * @return 1 if c_string is a palindrome, 0 otherwise
+ * @param workspace the workspace, do not reuse it afterwards
  */
-int8_t isPalindrom(char *c_string, int8_t ignore_case, int8_t ignore_whitespace) {
+void freeWorkspace(Workspace_t *workspace) {
+  if (workspace->use_cache) {
+    freeCache(&workspace->cache);
+  }
+  free(workspace->points);
+  free(workspace->first_point);
+  free(workspace->begin);
+  free(workspace->end);
+  free(workspace->radius);
+  memset(workspace, 0, sizeof(*workspace));
+}
 
-  int i = 0;
-  int j = strlen(c_string) - 1;
+/**
+ * @brief Makes sure a workspace is big enough for a line
+ *
+ * @detail Every character is at least one byte, so length is an upper bound for the number of
+ * points and units. The workspace grows to twice its size, so longer lines rarely allocate.
+ * Terminates the application if memory allocation fails.
+ * @param workspace the workspace
+ * @param length number of bytes in the line
+ */
+static void reserveWorkspace(Workspace_t *workspace, size_t length) {
+  if (likely(length <= workspace->unit_capacity)) {
+    return;
+  }
 
-  while (i < j) {
-    if (ignore_whitespace) {
-      // ignore whitespace from left
-      while (c_string[i] == ' ') {
-        ++i;
-        if (i > j) {
-          return 1;
-        }
+  size_t capacity = workspace->unit_capacity == 0 ? 256 : workspace->unit_capacity * 2;
+  while (capacity < length) {
+    capacity *= 2;
+  }
+
+  free(workspace->points);
+  free(workspace->first_point);
+  free(workspace->begin);
+  free(workspace->end);
+  free(workspace->radius);
+  workspace->points = malloc(sizeof(uint32_t) * capacity);
+  workspace->first_point = malloc(sizeof(size_t) * (capacity + 1));
+  workspace->begin = malloc(sizeof(size_t) * capacity);
+  workspace->end = malloc(sizeof(size_t) * capacity);
+  workspace->radius = malloc(sizeof(size_t) * (2 * capacity + 1));
+  if (workspace->points == NULL || workspace->first_point == NULL || workspace->begin == NULL ||
+      workspace->end == NULL || workspace->radius == NULL) {
+    fprintf(stderr, "FATAL ERROR out of memory");
+    exit(EXIT_FAILURE);
+  }
+  workspace->point_capacity = capacity;
+  workspace->unit_capacity = capacity;
+}
+
+/**
+ * @brief Normalizes a line the same way palindromCheck() compares it
+ *
+ * @detail Drops spaces if ignore_whitespace, lowers or folds the case if ignore_case, and
+ * splits the line into units that are compared as a whole: bytes, code points or grapheme
+ * clusters, depending on the options.
+ * @param options how lines are compared
+ * @param line the line
+ * @param length number of bytes in line
+ * @param workspace receives the units
+ * @return the number of units
+ */
+static size_t normalizeLine(const Options_t *options, const char *line, size_t length,
+                            Workspace_t *workspace) {
+  reserveWorkspace(workspace, length);
+
+  const bool ignore_case = options->flags & PALINDROM_IGNORE_CASE;
+  const bool ignore_whitespace = options->flags & PALINDROM_IGNORE_WHITESPACE;
+  const bool graphemes = options->flags & PALINDROM_GRAPHEMES;
+  const bool decode = (options->flags & PALINDROM_UTF8) && !isAscii(line, length);
+  size_t units = 0;
+  size_t points = 0;
+  size_t pos = 0;
+
+  while (pos < length) {
+    if (ignore_whitespace && line[pos] == ' ') {
+      ++pos;
+      continue;
+    }
+
+    workspace->first_point[units] = points;
+    workspace->begin[units] = pos;
+    if (!decode) {
+      const unsigned char c = line[pos++];
+      workspace->points[points++] = ignore_case ? tolower(c) : c;
+    } else {
+      const size_t unit_end = graphemes ? graphemeEnd(line, length, pos) : pos + 1;
+      do {
+        const uint32_t code_point = decodeUtf8(line, length, &pos);
+        workspace->points[points++] = ignore_case ? foldCase(code_point) : code_point;
+      } while (pos < unit_end);
+    }
+    workspace->end[units++] = pos;
+  }
+  workspace->first_point[units] = points;
+
+  return units;
+}
+
+/**
+ * @brief Compares two normalized units of a workspace
+ */
+static inline bool unitsEqual(const Workspace_t *workspace, size_t a, size_t b) {
+  const size_t *first_point = workspace->first_point;
+  const size_t points = first_point[a + 1] - first_point[a];
+  if (likely(points == 1)) {
+    return first_point[b + 1] - first_point[b] == 1 &&
+           workspace->points[first_point[a]] == workspace->points[first_point[b]];
+  }
+  return points == first_point[b + 1] - first_point[b] &&
+         memcmp(workspace->points + first_point[a], workspace->points + first_point[b],
+                sizeof(uint32_t) * points) == 0;
+}
+
+/**
+ * @brief Calculates the palindrome radius around every center with Manacher's algorithm
+ *
+ * @detail Works on the units interleaved with virtual separators, so center 2 * k + 1 is unit
+ * k, and the even centers lie between units. A radius of r means the palindrome is r units
+ * long and starts at unit (center - r) / 2. Runs in linear time.
+ * @param workspace contains the normalized units and receives the radii
+ * @param units number of units
+ */
+static void manacher(Workspace_t *workspace, size_t units) {
+  const size_t centers = 2 * units + 1;
+  size_t *radius = workspace->radius;
+  // the palindrome around center reaches furthest right, up to right
+  size_t center = 0;
+  size_t right = 0;
+
+  for (size_t i = 0; i < centers; ++i) {
+    size_t r = 0;
+    if (i < right) {
+      // mirror the radius of the center on the other side, as far as it is known
+      r = radius[2 * center - i];
+      if (r > right - i) {
+        r = right - i;
       }
+    }
 
-      // ignore whitespace from right
-      while (c_string[j] == ' ') {
-        --j;
-        if (i > j) {
-          return 1;
-        }
+    while (r < i && i + r + 1 < centers) {
+      const size_t a = i - r - 1;
+      const size_t b = i + r + 1;
+      // odd positions are units, even positions are separators and always match
+      if ((a & 1) && !unitsEqual(workspace, a / 2, b / 2)) {
+        break;
       }
+      ++r;
+    }
+
+    radius[i] = r;
+    if (i + r > right) {
+      center = i;
+      right = i + r;
     }
+  }
+}
 
-    if (ignore_case) {
-      if (tolower(c_string[i]) != tolower(c_string[j])) {
-        return 0;
+/**
+ * @brief Appends one found palindrome as byte offset:length in the original line
+ *
+ * @detail Separates it from what is already in front of it in the line with a space.
+ */
+static void appendPalindrom(const Workspace_t *workspace, size_t center, size_t radius,
+                            bool separate, Buffer_t *out) {
+  const size_t first = (center - radius) / 2;
+  const size_t last = first + radius - 1;
+  if (separate) {
+    appendBuffer(out, " ", 1);
+  }
+  appendNumber(out, workspace->begin[first]);
+  appendBuffer(out, ":", 1);
+  appendNumber(out, workspace->end[last] - workspace->begin[first]);
+}
+
+/**
+ * @brief Searches the palindromic substrings of a line and appends them to a buffer.
+ *
+ * @detail Depending on the options either the longest one, or all maximal ones with a minimum
+ * length are searched. Substrings are normalized like whole lines. Every result is written as
+ * byte offset:length in the original line.
+ *
+ * @param options how lines are compared and the results formatted
+ * @param line the line
+ * @param length number of bytes in line
+ * @param workspace memory for normalizing the line, is reused for the following lines
+ * @param out buffer the results are appended to
+ */
+void searchPalindroms(const Options_t *options, const char *line, size_t length,
+                      Workspace_t *workspace, Buffer_t *out) {
+  const size_t units = normalizeLine(options, line, length, workspace);
+  manacher(workspace, units);
+
+  const size_t *radius = workspace->radius;
+  // decide what was found before anything is written, as out may be flushed while appending
+  size_t best = 0;
+  bool found = false;
+  if (options->search == SEARCH_LONGEST) {
+    for (size_t i = 1; i < 2 * units + 1; ++i) {
+      if (radius[i] > radius[best]) {
+        best = i;
       }
+    }
+    found = radius[best] > 0;
+  } else {
+    for (size_t i = 0; i < 2 * units + 1 && !found; ++i) {
+      found = radius[i] >= options->min_length;
+    }
+  }
+
+  if (options->format == FORMAT_TEXT) {
+    appendBuffer(out, line, length);
+    if (!found) {
+      appendBuffer(out, " has no palindrom \n", strlen(" has no palindrom \n"));
+      return;
+    }
+    if (options->search == SEARCH_LONGEST) {
+      appendBuffer(out, " longest palindrom at", strlen(" longest palindrom at"));
     } else {
-      if (c_string[i] != c_string[j]) {
-        return 0;
+      appendBuffer(out, " palindroms at", strlen(" palindroms at"));
+    }
+  }
+
+  if (options->search == SEARCH_LONGEST) {
+    if (found) {
+      appendPalindrom(workspace, best, radius[best], options->format == FORMAT_TEXT, out);
+    }
+  } else {
+    bool separate = options->format == FORMAT_TEXT;
+    for (size_t i = 0; i < 2 * units + 1; ++i) {
+      if (radius[i] >= options->min_length) {
+        appendPalindrom(workspace, i, radius[i], separate, out);
+        separate = true;
       }
     }
+  }
 
-    ++i;
-    --j;
+  if (options->format == FORMAT_TEXT) {
+    appendBuffer(out, " \n", 2);
+  } else {
+    appendBuffer(out, "\n", 1);
   }
-  return 1;
 }
 
 /** @}*/
\ No newline at end of file
@@ -1 +1,51 @@
-#pragma once
\ No newline at end of file
+#pragma once
+
+/** @addtogroup Libispalindrom
+ *  @{
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** marks the functions libispalindrom.so exports, which is built with -fvisibility=hidden */
+#define PALINDROM_API __attribute__((visibility("default")))
+
+/** upper and lower case letters match, with PALINDROM_UTF8 after Unicode simple case folding */
+#define PALINDROM_IGNORE_CASE 0x1
+/** spaces (not '\t' and the like) are skipped */
+#define PALINDROM_IGNORE_WHITESPACE 0x2
+/** lines are UTF-8 and compared by code points instead of bytes */
+#define PALINDROM_UTF8 0x4
+/** lines are UTF-8 and compared by grapheme clusters, implies PALINDROM_UTF8 */
+#define PALINDROM_GRAPHEMES 0x8
+
+/** A line that does not need to be '\0' terminated */
+typedef struct palindromSpan {
+  const char *data;
+  size_t length;
+} PalindromSpan_t;
+
+/**
+ * @brief Receives the lines of a stream and their verdicts
+ *
+ * @param context the pointer passed to palindromStreamCreate()
+ * @param line the line without '\n', only valid during the call
+ * @param length number of bytes in line
+ * @param verdict 1 if the line is a palindrome, 0 otherwise
+ */
+typedef void (*PalindromCallback_t)(void *context, const char *line, size_t length, int verdict);
+
+typedef struct palindromStream PalindromStream_t;
+
+PALINDROM_API int palindromCheck(const char *line, size_t length, unsigned flags);
+PALINDROM_API int palindromCheckBatch(const PalindromSpan_t *spans, size_t count, unsigned flags,
+                                      uint64_t *verdicts);
+
+PALINDROM_API PalindromStream_t *palindromStreamCreate(unsigned flags,
+                                                       PalindromCallback_t callback,
+                                                       void *context);
+PALINDROM_API int palindromStreamFeed(PalindromStream_t *stream, const char *data, size_t length);
+PALINDROM_API int palindromStreamFinish(PalindromStream_t *stream);
+PALINDROM_API void palindromStreamDestroy(PalindromStream_t *stream);
+
+/** @}*/
@@ -0,0 +1,412 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) && !defined(PALINDROM_SCALAR)
+#include <emmintrin.h>
+#define PALINDROM_SSE2
+#endif
+
+/** @defgroup Libispalindrom */
+
+/** @addtogroup Libispalindrom
+ * @brief The palindrome checker of ispalindrom as a library
+ *
+ * @details Link against libispalindrom.a or libispalindrom.so and include ispalindrom.h.
+ * Lines can be checked one at a time, as a batch of spans, or by feeding a stream in chunks of
+ * any size, which are split into lines without copying them. Nothing in here terminates the
+ * application or writes to stdout or stderr, errors are reported through return values and
+ * errno.
+ *
+ * @author Markus Krainz
+ * @date November 2018
+ *  @{
+ */
+
+#include "ispalindrom.h"
+#include "utf8.h"
+
+#define KNOWN_FLAGS                                                                            \
+  (PALINDROM_IGNORE_CASE | PALINDROM_IGNORE_WHITESPACE | PALINDROM_UTF8 | PALINDROM_GRAPHEMES)
+
+struct palindromStream {
+  unsigned flags;
+  PalindromCallback_t callback;
+  void *context;
+  /** the incomplete line at the end of the chunks fed so far */
+  char *carry;
+  size_t carry_size;
+  size_t carry_capacity;
+};
+
+/**
+ * @brief returns != 0 if the line is a palindrom
+ *
+ * @detail May skip spaces and match different cases as equal depending on parameters.
+ *
+ * @param line pointer to the char sequence which will be tested for being a palindrom. It does
+ * not need to be '\0' terminated.
+ * @param length number of chars in line
+ * @param ignore_case if != 0 then then upper/lower-case is ignored when processing
+ * palindrome
+ * @param ignore_whitespace if != 0 then then all whitespace (not including special
+ * characters like '\t') is ignored when processing palindrome
+ * @return 1 if line is a palindrome, 0 otherwise
+ */
+static int8_t isPalindrom(const char *line, size_t length, int8_t ignore_case,
+                          int8_t ignore_whitespace) {
+  if (length < 2) {
+    return 1;
+  }
+
+  size_t i = 0;
+  size_t j = length - 1;
+
+
+  while (i < j) {
+    if (ignore_whitespace) {
+      // ignore whitespace from left
+      while (line[i] == ' ') {
+        ++i;
+        if (i >= j) {
+          return 1;
+        }
+      }
+
+      // ignore whitespace from right
+      while (line[j] == ' ') {
+        --j;
+        if (i >= j) {
+          return 1;
+        }
+      }
+    }
+
+    if (ignore_case) {
+      if (tolower((unsigned char)line[i]) != tolower((unsigned char)line[j])) {
+        return 0;
+      }
+    } else {
+      if (line[i] != line[j]) {
+        return 0;
+      }
+    }
+
+    ++i;
+    --j;
+  }
+  return 1;
+}
+
+#ifdef PALINDROM_SSE2
+/**
+ * @brief returns != 0 if the line is a palindrom, comparing 16 chars at once
+ *
+ * @detail Compares the first 16 chars with the reversed last 16 chars until less than 32 are
+ * left, which are compared one by one. Skipping whitespace would shift both sides
+ * differently, so that is not supported here.
+ *
+ * @param line pointer to the char sequence which will be tested for being a palindrom
+ * @param length number of chars in line
+ * @param ignore_case if != 0 then then upper/lower-case is ignored when processing
+ * palindrome
+ * @return 1 if line is a palindrome, 0 otherwise
+ */
+static int8_t isPalindromSse2(const char *line, size_t length, int8_t ignore_case) {
+  const __m128i before_a = _mm_set1_epi8('A' - 1);
+  const __m128i after_z = _mm_set1_epi8('Z' + 1);
+  const __m128i case_bit = _mm_set1_epi8('a' - 'A');
+
+  while (length >= 32) {
+    __m128i left = _mm_loadu_si128((const __m128i *)line);
+    __m128i right = _mm_loadu_si128((const __m128i *)(line + length - 16));
+
+    // reverse the bytes: first the dwords, then the words in them, then the bytes in those
+    right = _mm_shuffle_epi32(right, _MM_SHUFFLE(0, 1, 2, 3));
+    right = _mm_shufflelo_epi16(right, _MM_SHUFFLE(2, 3, 0, 1));
+    right = _mm_shufflehi_epi16(right, _MM_SHUFFLE(2, 3, 0, 1));
+    right = _mm_or_si128(_mm_slli_epi16(right, 8), _mm_srli_epi16(right, 8));
+
+    if (ignore_case) {
+      // like tolower in the C locale, the signed compare leaves bytes >= 0x80 alone
+      const __m128i left_upper =
+          _mm_and_si128(_mm_cmpgt_epi8(left, before_a), _mm_cmplt_epi8(left, after_z));
+      const __m128i right_upper =
+          _mm_and_si128(_mm_cmpgt_epi8(right, before_a), _mm_cmplt_epi8(right, after_z));
+      left = _mm_or_si128(left, _mm_and_si128(left_upper, case_bit));
+      right = _mm_or_si128(right, _mm_and_si128(right_upper, case_bit));
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(left, right)) != 0xFFFF) {
+      return 0;
+    }
+    line += 16;
+    length -= 32;
+  }
+
+  if (length < 2) {
+    return 1;
+  }
+  for (size_t i = 0, j = length - 1; i < j; ++i, --j) {
+    if (ignore_case ? tolower((unsigned char)line[i]) != tolower((unsigned char)line[j])
+                    : line[i] != line[j]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+#endif
+
+/**
+ * @brief returns != 0 if the UTF-8 encoded line is a palindrom
+ *
+ * @detail Compares whole code points, or grapheme clusters, from both ends. So multibyte
+ * characters are not reversed byte by byte. Invalid bytes only match themselves.
+ *
+ * @param line pointer to the UTF-8 encoded chars which will be tested for being a palindrom
+ * @param length number of bytes in line
+ * @param ignore_case if != 0 then code points are compared after Unicode simple case folding
+ * @param ignore_whitespace if != 0 then then all whitespace (not including special
+ * characters like '\t') is ignored when processing palindrome
+ * @param graphemes if != 0 then base characters and their combining marks are compared together
+ * @return 1 if line is a palindrome, 0 otherwise
+ */
+static int8_t isPalindromUtf8(const char *line, size_t length, int8_t ignore_case,
+                              int8_t ignore_whitespace, int8_t graphemes) {
+  // line[left..right) is what is left to compare
+  size_t left = 0;
+  size_t right = length;
+
+  while (left < right) {
+    if (ignore_whitespace) {
+      while (left < right && line[left] == ' ') {
+        ++left;
+      }
+      while (left < right && line[right - 1] == ' ') {
+        --right;
+      }
+      if (left >= right) {
+        return 1;
+      }
+    }
+
+    size_t left_end = left;
+    size_t right_start = right;
+    if (graphemes) {
+      left_end = graphemeEnd(line, right, left);
+      right_start = graphemeStart(line, left, right);
+    } else {
+      decodeUtf8(line, right, &left_end);
+      decodeUtf8Backward(line, left, &right_start);
+    }
+
+    if (left_end > right_start) {
+      // both ends reached the same character in the middle
+      return 1;
+    }
+
+    // compare line[left..left_end) with line[right_start..right) code point by code point
+    size_t a = left;
+    size_t b = right_start;
+    while (a < left_end && b < right) {
+      uint32_t code_point_a = decodeUtf8(line, left_end, &a);
+      uint32_t code_point_b = decodeUtf8(line, right, &b);
+      if (ignore_case) {
+        code_point_a = foldCase(code_point_a);
+        code_point_b = foldCase(code_point_b);
+      }
+      if (code_point_a != code_point_b) {
+        return 0;
+      }
+    }
+    if (a != left_end || b != right) {
+      return 0;
+    }
+
+    left = left_end;
+    right = right_start;
+  }
+  return 1;
+}
+
+
+/**
+ * @brief Checks a line with the fastest variant that supports the flags
+ *
+ * @param line the line, it does not need to be '\0' terminated
+ * @param length number of bytes in line
+ * @param flags PALINDROM_* flags, unknown ones are ignored
+ * @return 1 if line is a palindrome, 0 otherwise
+ */
+int palindromCheck(const char *line, size_t length, unsigned flags) {
+  const int8_t ignore_case = (flags & PALINDROM_IGNORE_CASE) != 0;
+  const int8_t ignore_whitespace = (flags & PALINDROM_IGNORE_WHITESPACE) != 0;
+
+  // pure ASCII lines take the fast path even in UTF-8 mode
+  if ((flags & (PALINDROM_UTF8 | PALINDROM_GRAPHEMES)) && !isAscii(line, length)) {
+    return isPalindromUtf8(line, length, ignore_case, ignore_whitespace,
+                           (flags & PALINDROM_GRAPHEMES) != 0);
+  }
+#ifdef PALINDROM_SSE2
+  if (!ignore_whitespace && length >= 32) {
+    return isPalindromSse2(line, length, ignore_case);
+  }
+#endif
+  return isPalindrom(line, length, ignore_case, ignore_whitespace);
+}
+
+/**
+ * @brief Checks many lines at once
+ *
+ * @detail The spans may point anywhere, they do not need to be adjacent or in order.
+ * @param spans the lines
+ * @param count number of spans
+ * @param flags PALINDROM_* flags
+ * @param verdicts bitmap of (count + 63) / 64 words, bit i % 64 of word i / 64 is set if span i
+ * is a palindrome. Bits behind count are cleared.
+ * @return 0 on success, -1 if flags contains unknown bits and errno is set to EINVAL
+ */
+int palindromCheckBatch(const PalindromSpan_t *spans, size_t count, unsigned flags,
+                        uint64_t *verdicts) {
+  if (flags & ~KNOWN_FLAGS) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  for (size_t word = 0; word * 64 < count; ++word) {
+    const size_t first = word * 64;
+    const size_t last = count - first < 64 ? count : first + 64;
+    uint64_t bits = 0;
+    for (size_t i = first; i < last; ++i) {
+      bits |= (uint64_t)palindromCheck(spans[i].data, spans[i].length, flags) << (i - first);
+    }
+    verdicts[word] = bits;
+  }
+  return 0;
+}
+
+/**
+ * @brief Creates a stream that checks the lines of data fed in arbitrary chunks
+ *
+ * @param flags PALINDROM_* flags
+ * @param callback called for every line with its verdict, in input order
+ * @param context passed on to the callback
+ * @return the stream, or NULL with errno set to EINVAL for unknown flags or ENOMEM
+ */
+PalindromStream_t *palindromStreamCreate(unsigned flags, PalindromCallback_t callback,
+                                         void *context) {
+  if ((flags & ~KNOWN_FLAGS) || callback == NULL) {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  PalindromStream_t *stream = malloc(sizeof(PalindromStream_t));
+  if (stream == NULL) {
+    errno = ENOMEM;
+    return NULL;
+  }
+  stream->flags = flags;
+  stream->callback = callback;
+  stream->context = context;
+  stream->carry = NULL;
+  stream->carry_size = 0;
+  stream->carry_capacity = 0;
+  return stream;
+}
+
+/**
+ * @brief Appends bytes to the incomplete line of a stream
+ *
+ * @return 0 on success, -1 with errno set to ENOMEM
+ */
+static int appendCarry(PalindromStream_t *stream, const char *data, size_t length) {
+  if (stream->carry_size + length > stream->carry_capacity) {
+    size_t capacity = stream->carry_capacity == 0 ? 256 : stream->carry_capacity * 2;
+    while (capacity < stream->carry_size + length) {
+      capacity *= 2;
+    }
+    char *bigger = realloc(stream->carry, capacity);
+    if (bigger == NULL) {
+      errno = ENOMEM;
+      return -1;
+    }
+    stream->carry = bigger;
+    stream->carry_capacity = capacity;
+  }
+  memcpy(stream->carry + stream->carry_size, data, length);
+  stream->carry_size += length;
+  return 0;
+}
+
+/**
+ * @brief Checks all lines completed by a chunk of data
+ *
+ * @detail Lines that are completely inside the chunk are checked in place. Only the line that is
+ * still incomplete at the end of the chunk is copied, until a later chunk completes it.
+ * @param stream the stream
+ * @param data the chunk, it may start or end in the middle of a line
+ * @param length number of bytes in data
+ * @return 0 on success, -1 with errno set to ENOMEM
+ */
+int palindromStreamFeed(PalindromStream_t *stream, const char *data, size_t length) {
+  const char *const end = data + length;
+
+  if (stream->carry_size > 0) {
+    const char *newline = memchr(data, '\n', length);
+    if (newline == NULL) {
+      return appendCarry(stream, data, length);
+    }
+    if (appendCarry(stream, data, newline - data) == -1) {
+      return -1;
+    }
+    stream->callback(stream->context, stream->carry, stream->carry_size,
+                     palindromCheck(stream->carry, stream->carry_size, stream->flags));
+    stream->carry_size = 0;
+    data = newline + 1;
+  }
+
+  while (data < end) {
+    const char *newline = memchr(data, '\n', end - data);
+    if (newline == NULL) {
+      return appendCarry(stream, data, end - data);
+    }
+    stream->callback(stream->context, data, newline - data,
+                     palindromCheck(data, newline - data, stream->flags));
+    data = newline + 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Checks the last line of a stream if it did not end with '\n'
+ *
+ * @detail Afterwards the stream can be fed the next input.
+ * @param stream the stream
+ * @return 0
+ */
+int palindromStreamFinish(PalindromStream_t *stream) {
+  if (stream->carry_size > 0) {
+    stream->callback(stream->context, stream->carry, stream->carry_size,
+                     palindromCheck(stream->carry, stream->carry_size, stream->flags));
+    stream->carry_size = 0;
+  }
+  return 0;
+}
+
+/**
+ * @brief Frees a stream without checking an incomplete last line
+ *
+ * @param stream the stream, do not reuse it afterwards
+ */
+void palindromStreamDestroy(PalindromStream_t *stream) {
+  if (stream == NULL) {
+    return;
+  }
+  free(stream->carry);
+  free(stream);
+}
+
+/** @}*/
@@ -0,0 +1,176 @@
+#!/bin/sh
+# Author Markus Krainz
+# Date 2018
+# Checks the substring search of ispalindrom on output bigger than the output buffer, so its
+# results are flushed in the middle of lines, and the options that must not change the output.
+#
+# Usage: ./test.sh [lines]
+# The output of -l and -m has to match a brute force search of the same lines, which is slow but
+# too simple to share a bug with Manacher's algorithm. -u and -g have to give the same output as
+# without them for ASCII lines, and known verdicts for a few UTF-8 lines. -c and gzip compressed
+# input have to give the same output as plain input, and -c has to be rejected with -l and -m.
+
+set -e
+
+LINES=${1:-60000}
+MIN_LENGTH=30
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# random palindromes of up to 161 letters, half of them with one letter changed, so they contain
+# long palindromic substrings that are not the whole line
+file="$dir/search.txt"
+awk -v lines="$LINES" 'BEGIN {
+  srand(5)
+  for (n = 0; n < lines; ++n) {
+    half = int(rand() * 81)
+    line = ""
+    for (i = 0; i < half; ++i) line = line substr("abcdefghijklmnopqrstuvwxyz", int(rand() * 26) + 1, 1)
+    mirror = ""
+    for (i = half; i > 0; --i) mirror = mirror substr(line, i, 1)
+    line = line (rand() < 0.5 ? "" : "x") mirror
+    if (line != "" && rand() < 0.5) {
+      i = int(rand() * length(line))
+      line = substr(line, 1, i) "0" substr(line, i + 2)
+    }
+    print line
+  }
+}' > "$file"
+out="$dir/search-out.txt"
+expected="$dir/search-expected.txt"
+
+failures=0
+for mode in "-l" "-m $MIN_LENGTH"; do
+  # the answer of a brute force search, which expands a palindrome around every center
+  LC_ALL=C awk -v min="$MIN_LENGTH" -v longest="$mode" '
+    {
+      n = length($0)
+      for (k = 1; k <= n; ++k) c[k] = substr($0, k, 1)
+      found = ""
+      best = 0
+      # center i is character (i - 1) / 2 if i is odd, or the gap in front of character i / 2
+      for (i = 0; i <= 2 * n; ++i) {
+        # the palindrome spans the characters [first, last), counted from 0
+        first = int(i / 2)
+        last = first + i % 2
+        while (first > 0 && last < n && c[first] == c[last + 1]) {
+          --first
+          ++last
+        }
+        if (longest == "-l") {
+          if (last - first > best) {
+            best = last - first
+            found = " " first ":" best
+          }
+        } else if (last - first >= min) {
+          found = found " " first ":" (last - first)
+        }
+      }
+      if (found == "") print $0 " has no palindrom "
+      else print $0 (longest == "-l" ? " longest palindrom at" : " palindroms at") found " "
+    }
+  ' "$file" > "$expected"
+
+  for threads in 1 2; do
+    # shellcheck disable=SC2086
+    ./ispalindrom $mode -j $threads "$file" > "$out"
+    bytes=$(wc -c < "$out")
+    if ! cmp -s "$expected" "$out"; then
+      echo "ispalindrom $mode -j $threads, $bytes bytes of output, differs from the brute force search:" >&2
+      diff "$expected" "$out" | head -5 >&2
+      failures=$((failures + 1))
+    else
+      echo "ispalindrom $mode -j $threads: ok, $bytes bytes of output"
+    fi
+  done
+done
+
+# mixed case lines with spaces, half of them palindromes if case and spaces are ignored, drawn
+# from a few hundred distinct lines
+lines="$dir/lines.txt"
+awk -v lines="$LINES" 'BEGIN {
+  srand(7)
+  for (n = 0; n < 300; ++n) {
+    half = 8 + int(rand() * 25)
+    line = ""
+    for (i = 0; i < half; ++i) line = line substr("abcdAB ", int(rand() * 7) + 1, 1)
+    mirror = ""
+    for (i = half; i > 0; --i) {
+      c = substr(line, i, 1)
+      mirror = mirror (rand() < 0.2 ? toupper(c) : c) (rand() < 0.1 ? " " : "")
+    }
+    distinct[n] = line (rand() < 0.5 ? mirror : substr(mirror, 2) "e")
+  }
+  for (n = 0; n < lines; ++n) print distinct[int(rand() * 300)]
+}' > "$lines"
+reference="$dir/reference.txt"
+
+# ASCII lines are the same characters with -u and -g
+for options in "" "-i" "-s" "-i -s" "-l" "-m 5"; do
+  # shellcheck disable=SC2086
+  ./ispalindrom $options "$lines" > "$reference"
+  for unicode in "-u" "-g"; do
+    # shellcheck disable=SC2086
+    ./ispalindrom $unicode $options "$lines" > "$out"
+    if ! cmp -s "$reference" "$out"; then
+      echo "ispalindrom $unicode $options differs from ispalindrom $options:" >&2
+      diff "$reference" "$out" | head -5 >&2
+      failures=$((failures + 1))
+    fi
+  done
+done
+echo "ispalindrom -u and -g: same output for ASCII lines"
+
+# a precomposed umlaut, case folding of umlauts, and an accent as a combining character
+printf '\303\244b\303\244\n\303\204nn\303\244\nr\314\201ar\314\201\n' > "$dir/utf8.txt"
+for expected in ":000" "-u:100" "-u -i:110" "-g:101" "-g -i:111"; do
+  options=${expected%:*}
+  # shellcheck disable=SC2086
+  flags=$(./ispalindrom -f flag $options "$dir/utf8.txt" | tr -d '\n')
+  if [ "$flags" != "${expected#*:}" ]; then
+    echo "ispalindrom $options: UTF-8 lines are $flags instead of ${expected#*:}" >&2
+    failures=$((failures + 1))
+  fi
+done
+echo "ispalindrom -u and -g: UTF-8 lines checked"
+
+# the cache only skips checks, the repetitive lines have to get the same verdicts
+for options in "" "-i -s" "-u -i" "-f flag"; do
+  # shellcheck disable=SC2086
+  ./ispalindrom $options "$lines" > "$reference"
+  for threads in 1 2; do
+    # shellcheck disable=SC2086
+    ./ispalindrom -c 1024 -j $threads $options "$lines" > "$out" 2> "$dir/hits.txt"
+    if ! cmp -s "$reference" "$out"; then
+      echo "ispalindrom -c 1024 -j $threads $options differs from ispalindrom $options:" >&2
+      diff "$reference" "$out" | head -5 >&2
+      failures=$((failures + 1))
+    fi
+  done
+done
+echo "ispalindrom -c: same output as without the cache, $(cat "$dir/hits.txt")"
+
+for search in "-l" "-m 5"; do
+  # shellcheck disable=SC2086
+  if ./ispalindrom -c 1024 $search "$lines" > /dev/null 2>&1; then
+    echo "ispalindrom -c 1024 $search is not rejected" >&2
+    failures=$((failures + 1))
+  fi
+done
+echo "ispalindrom -c: rejected with -l and -m"
+
+# compressed input is recognized by its magic bytes, in files and on stdin
+./ispalindrom -i -s "$lines" > "$reference"
+gzip -c "$lines" > "$dir/lines.gz"
+./ispalindrom -i -s "$dir/lines.gz" > "$out"
+./ispalindrom -i -s < "$dir/lines.gz" > "$dir/stdin-out.txt"
+if ! cmp -s "$reference" "$out" || ! cmp -s "$reference" "$dir/stdin-out.txt"; then
+  echo "ispalindrom of gzip compressed lines differs from the uncompressed lines" >&2
+  failures=$((failures + 1))
+fi
+echo "ispalindrom: same output for gzip compressed lines"
+
+if [ $failures -gt 0 ]; then
+  exit 1
+fi
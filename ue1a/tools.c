@@ -0,0 +1,427 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/** @defgroup Tools */
+
+/** @addtogroup Tools
+ * @brief Provides Utility Tools
+ *
+ * @details Right now mostly reading input files in big blocks that only contain whole lines,
+ * decompressing them on the fly if they are gzip or zstd compressed, and
+ * buffers to collect output in and write it with as few system calls as possible, and a cache
+ * for the verdicts of lines that repeat.
+ *
+ * @author Markus Krainz
+ * @date November 2018
+ *  @{
+ */
+
+#include "tools.h"
+
+/**
+ * @brief Returns the offset behind the last '\n' in data[0..len), or 0 if there is none.
+ *
+ * @detail We only ever search the tail of a block, which is typically shorter than a line.
+ */
+static size_t endOfLastLine(const char *data, size_t len) {
+  while (len > 0 && data[len - 1] != '\n') {
+    --len;
+  }
+  return len;
+}
+
+/**
+ * @brief Reads the first bytes of a stream until it is clear whether it is compressed
+ *
+ * @detail Terminals are never waited on once a line is complete.
+ * @return 0 on success, -1 on failure and errno is set
+ */
+static int readMagic(Input_t *input) {
+  while (!input->eof && mayBeCompressed(input->data, input->end) &&
+         !(input->interactive && memchr(input->data, '\n', input->end) != NULL)) {
+    const ssize_t res = read(input->fd, input->data + input->end, MAGIC_LENGTH - input->end);
+    if (res == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (res == 0) {
+      input->eof = true;
+    }
+    input->end += res;
+  }
+  return 0;
+}
+
+/**
+ * @brief Prepares reading from a file descriptor
+ *
+ * @detail Regular files are memory mapped and announced for sequential access.
+ * Everything else (pipes, terminals, empty or special files) is read through a big buffer, which
+ * is filled completely before lines are handed out, unless we read from a terminal.
+ * gzip or zstd compressed input is recognized by its magic number and decompressed by a separate
+ * thread into a pipe, which is then read like any other stream.
+ * The file descriptor is not closed by closeInput().
+ * @param input the input to be initialized
+ * @param fd an open file descriptor
+ * @return 0 on success, -1 on failure and errno is set
+ */
+int openInput(Input_t *input, int fd) {
+  input->fd = fd;
+  input->mapped = false;
+  input->interactive = isatty(fd);
+  input->eof = false;
+  input->pos = 0;
+  input->end = 0;
+  input->decompressor = NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    char magic[MAGIC_LENGTH];
+    const ssize_t magic_length = pread(fd, magic, MAGIC_LENGTH, 0);
+    const Compression_t compression =
+        detectCompression(magic, magic_length > 0 ? magic_length : 0);
+    if (compression != COMPRESSION_NONE) {
+      input->decompressor = startDecompressor(fd, compression, NULL, 0);
+      if (input->decompressor == NULL) {
+        return -1;
+      }
+      input->fd = input->decompressor->output_fd;
+      input->interactive = false;
+    } else {
+      void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+        // this is only a hint, so we do not care if it fails
+        madvise(map, st.st_size, MADV_SEQUENTIAL);
+        input->mapped = true;
+        input->data = map;
+        input->size = st.st_size;
+        return 0;
+      }
+    }
+  }
+
+  input->data = malloc(READ_BUFFER_SIZE);
+  if (input->data == NULL) {
+    errno = ENOMEM;
+    if (input->decompressor != NULL) {
+      stopDecompressor(input->decompressor);
+      input->decompressor = NULL;
+    }
+    return -1;
+  }
+  input->size = READ_BUFFER_SIZE;
+
+  if (input->decompressor == NULL) {
+    if (readMagic(input) == -1) {
+      free(input->data);
+      return -1;
+    }
+    const Compression_t compression = detectCompression(input->data, input->end);
+    if (compression != COMPRESSION_NONE) {
+      input->decompressor = startDecompressor(fd, compression, input->data, input->end);
+      if (input->decompressor == NULL) {
+        free(input->data);
+        return -1;
+      }
+      input->fd = input->decompressor->output_fd;
+      input->interactive = false;
+      input->end = 0;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Returns the next block of whole lines
+ *
+ * @detail Every block ends with '\n', except for the very last one if the input does not. So
+ * lines never span over two blocks. The block stays valid until the next call.
+ * @param input an input opened with openInput()
+ * @param block is set to the beginning of the block
+ * @return the length of the block, 0 at the end of input, or -1 on failure with errno set
+ */
+ssize_t nextBlock(Input_t *input, const char **block) {
+  if (input->mapped) {
+    if (input->pos == input->size) {
+      return 0;
+    }
+
+    size_t len = input->size - input->pos;
+    if (len > MAPPED_BLOCK_SIZE) {
+      const char *start = input->data + input->pos;
+      len = endOfLastLine(start, MAPPED_BLOCK_SIZE);
+      if (len == 0) {
+        // a single line longer than the block size, extend up to its end
+        const char *newline =
+            memchr(start + MAPPED_BLOCK_SIZE, '\n', input->size - input->pos - MAPPED_BLOCK_SIZE);
+        len = newline == NULL ? input->size - input->pos : (size_t)(newline - start) + 1;
+      }
+    }
+
+    *block = input->data + input->pos;
+    input->pos += len;
+    return len;
+  }
+
+  // move the incomplete line left over from the last block to the front
+  memmove(input->data, input->data + input->pos, input->end - input->pos);
+  input->end -= input->pos;
+  input->pos = 0;
+
+  while (true) {
+    while (!input->eof && input->end < input->size) {
+      const ssize_t res = read(input->fd, input->data + input->end, input->size - input->end);
+      if (res == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return -1;
+      }
+      if (res == 0) {
+        input->eof = true;
+        if (input->decompressor != NULL) {
+          // corrupt or truncated compressed input must not look like a clean end
+          const int stopped = stopDecompressor(input->decompressor);
+          input->decompressor = NULL;
+          if (stopped == -1) {
+            return -1;
+          }
+        }
+      }
+      input->end += res;
+
+      if (input->interactive && endOfLastLine(input->data, input->end) > 0) {
+        // do not wait for a full buffer while a user is typing
+        break;
+      }
+    }
+
+    size_t len = input->eof ? input->end : endOfLastLine(input->data, input->end);
+    if (len > 0 || input->eof) {
+      *block = input->data;
+      input->pos = len;
+      return len;
+    }
+
+    // the buffer is full, but does not even contain one whole line
+    char *bigger = realloc(input->data, input->size * 2);
+    if (bigger == NULL) {
+      errno = ENOMEM;
+      return -1;
+    }
+    input->data = bigger;
+    input->size *= 2;
+  }
+}
+
+/**
+ * @brief Releases the mapping or read buffer of an input and stops its decompression
+ *
+ * @param input the input, do not reuse it afterwards
+ */
+void closeInput(Input_t *input) {
+  if (input->decompressor != NULL) {
+    // we stopped reading early, so whatever the thread failed with does not matter
+    stopDecompressor(input->decompressor);
+    input->decompressor = NULL;
+  }
+  if (input->mapped) {
+    munmap(input->data, input->size);
+  } else {
+    free(input->data);
+  }
+  input->data = NULL;
+  input->size = 0;
+}
+
+/**
+ * @brief Initializes a buffer and allocates some memory
+ *
+ * @detail Terminates the application if memory allocation fails
+ * @param buffer The buffer to be initialized
+ * @param fd file descriptor the buffer is flushed to when it is full, or -1 to let it grow
+ */
+void initBuffer(Buffer_t *buffer, int fd) {
+  const size_t capacity = fd == -1 ? INITIAL_BUFFER_CAPACITY : OUTPUT_FLUSH_SIZE;
+  buffer->data = malloc(capacity);
+  if (unlikely(buffer->data == NULL)) {
+    fprintf(stderr, "FATAL ERROR out of memory");
+    exit(EXIT_FAILURE);
+  }
+  buffer->fd = fd;
+  buffer->size = 0;
+  buffer->capacity = capacity;
+}
+
+/**
+ * @brief Makes room for at least length more bytes in a buffer
+ *
+ * @detail Buffers with a file descriptor are flushed first. Only if that is not enough the
+ * buffer grows. Terminates the application if memory allocation or writing fails.
+ * @param buffer The buffer
+ * @param length number of bytes that will be appended
+ */
+void reserveBuffer(Buffer_t *buffer, size_t length) {
+  if (buffer->fd != -1) {
+    flushBuffer(buffer);
+  }
+  if (buffer->size + length > buffer->capacity) {
+    size_t capacity = buffer->capacity * 2;
+    while (capacity < buffer->size + length) {
+      capacity *= 2;
+    }
+    buffer->data = realloc(buffer->data, capacity);
+    if (unlikely(buffer->data == NULL)) {
+      fprintf(stderr, "FATAL ERROR out of memory");
+      exit(EXIT_FAILURE);
+    }
+    buffer->capacity = capacity;
+  }
+}
+
+/**
+ * @brief Writes the content of a buffer to its file descriptor and empties it
+ *
+ * @detail Terminates the application if writing fails.
+ * @param buffer The buffer, which must have a file descriptor
+ */
+void flushBuffer(Buffer_t *buffer) {
+  Buffer_t *buffers[] = {buffer};
+  writevBuffers(buffer->fd, buffers, 1);
+  buffer->size = 0;
+}
+
+/**
+ * @brief Writes the content of several buffers with as few system calls as possible
+ *
+ * @detail Also takes care of partial writes. Terminates the application if writing fails.
+ * The buffers are not emptied.
+ * @param fd file descriptor to write to
+ * @param buffers the buffers, in the order they are to be written
+ * @param count number of buffers
+ */
+void writevBuffers(int fd, Buffer_t *const *buffers, size_t count) {
+  while (count > 0) {
+    struct iovec iov[MAX_WRITEV_BUFFERS];
+    const size_t batch = count < MAX_WRITEV_BUFFERS ? count : MAX_WRITEV_BUFFERS;
+    size_t first = 0;
+    for (size_t i = 0; i < batch; ++i) {
+      iov[i].iov_base = buffers[i]->data;
+      iov[i].iov_len = buffers[i]->size;
+    }
+
+    while (first < batch) {
+      const ssize_t res = writev(fd, iov + first, batch - first);
+      if (res == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        fprintf(stderr, "FATAL ERROR writing output failed: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+      }
+
+      // skip everything that has been written
+      size_t written = res;
+      while (first < batch && written >= iov[first].iov_len) {
+        written -= iov[first].iov_len;
+        ++first;
+      }
+      if (first < batch) {
+        iov[first].iov_base = (char *)iov[first].iov_base + written;
+        iov[first].iov_len -= written;
+      }
+    }
+
+    buffers += batch;
+    count -= batch;
+  }
+}
+
+/**
+ * @brief Frees a buffer
+ *
+ * @detail After this function has been called do not reuse the buffer.
+ * @param buffer The buffer
+ */
+void freeBuffer(Buffer_t *buffer) {
+  free(buffer->data);
+  buffer->data = NULL;
+  buffer->size = 0;
+  buffer->capacity = 0;
+}
+
+/**
+ * @brief Hashes a line, 8 bytes at a time
+ *
+ * @detail Lines are only identified by hash and length, so the hash is finalized with the
+ * MurmurHash3 mixer to spread similar lines over all 64 bits.
+ * @param line the line
+ * @param length number of bytes in line
+ * @return the hash
+ */
+uint64_t hashLine(const char *line, size_t length) {
+  const uint64_t multiplier = 0x9E3779B97F4A7C15ULL;
+  uint64_t hash = length * multiplier;
+  size_t i = 0;
+
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, line + i, sizeof(word));
+    hash = ((hash << 5 | hash >> 59) ^ word) * multiplier;
+  }
+  if (i < length) {
+    uint64_t word = 0;
+    memcpy(&word, line + i, length - i);
+    hash = ((hash << 5 | hash >> 59) ^ word) * multiplier;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * @brief Initializes an empty cache
+ *
+ * @detail Each line has exactly one slot it can be stored in, so the cache never grows.
+ * Terminates the application if memory allocation fails.
+ * @param cache The cache to be initialized
+ * @param entries number of lines the cache can hold, rounded up to a power of two
+ */
+void initCache(Cache_t *cache, size_t entries) {
+  size_t capacity = 1;
+  while (capacity < entries) {
+    capacity *= 2;
+  }
+  cache->entries = calloc(capacity, sizeof(CacheEntry_t));
+  if (unlikely(cache->entries == NULL)) {
+    fprintf(stderr, "FATAL ERROR out of memory");
+    exit(EXIT_FAILURE);
+  }
+  cache->mask = capacity - 1;
+  cache->lookups = 0;
+  cache->hits = 0;
+}
+
+/**
+ * @brief Frees a cache
+ *
+ * @param cache The cache, do not reuse it afterwards
+ */
+void freeCache(Cache_t *cache) {
+  free(cache->entries);
+  cache->entries = NULL;
+}
+
+/** @}*/
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "decompress.h"
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+/** Maximum size of a block handed out from a memory mapped file */
+#define MAPPED_BLOCK_SIZE (64 * 1024 * 1024)
+/** Initial size of the read buffer used for pipes and terminals */
+#define READ_BUFFER_SIZE (1024 * 1024)
+
+typedef struct input {
+  int fd;
+  bool mapped;
+  bool interactive;
+  bool eof;
+  char *data;
+  size_t size;
+  size_t pos;
+  size_t end;
+  /** decompresses the original file descriptor into fd, or NULL for plain text */
+  Decompressor_t *decompressor;
+} Input_t;
+
+int openInput(Input_t *input, int fd);
+ssize_t nextBlock(Input_t *input, const char **block);
+void closeInput(Input_t *input);
+
+typedef struct buffer {
+  int fd;
+  char *data;
+  size_t size;
+  size_t capacity;
+} Buffer_t;
+
+#define INITIAL_BUFFER_CAPACITY (64 * 1024)
+/** Buffers that belong to a file descriptor are written out once they hold this many bytes */
+#define OUTPUT_FLUSH_SIZE (1024 * 1024)
+/** Maximum number of buffers written by a single writev */
+#define MAX_WRITEV_BUFFERS 64
+
+void initBuffer(Buffer_t *buffer, int fd);
+void reserveBuffer(Buffer_t *buffer, size_t length);
+void flushBuffer(Buffer_t *buffer);
+void writevBuffers(int fd, Buffer_t *const *buffers, size_t count);
+void freeBuffer(Buffer_t *buffer);
+
+/**
+ * @brief Appends bytes to a buffer
+ *
+ * @detail Buffers with a file descriptor are flushed when they are full, all others grow.
+ * Terminates the application if memory allocation or writing fails.
+ * @param buffer The buffer
+ * @param data the bytes to be appended
+ * @param length number of bytes in data
+ */
+static inline void appendBuffer(Buffer_t *buffer, const char *data, size_t length) {
+  if (unlikely(buffer->size + length > buffer->capacity)) {
+    reserveBuffer(buffer, length);
+  }
+  memcpy(buffer->data + buffer->size, data, length);
+  buffer->size += length;
+}
+
+/** Shorter lines are checked faster than they are hashed, so they are never cached */
+#define CACHE_MIN_LENGTH 16
+
+typedef struct cacheEntry {
+  uint64_t hash;
+  /** length of the line shifted left by one, with the verdict in the lowest bit. 0 if empty. */
+  uint64_t length_verdict;
+} CacheEntry_t;
+
+typedef struct cache {
+  CacheEntry_t *entries;
+  size_t mask;
+  size_t lookups;
+  size_t hits;
+} Cache_t;
+
+uint64_t hashLine(const char *line, size_t length);
+void initCache(Cache_t *cache, size_t entries);
+void freeCache(Cache_t *cache);
+
+/**
+ * @brief Looks up the verdict of a line
+ *
+ * @param cache the cache
+ * @param hash hashLine() of the line
+ * @param length number of bytes in the line
+ * @return the cached verdict, or -1 if the line is not cached
+ */
+static inline int8_t lookupCache(Cache_t *cache, uint64_t hash, size_t length) {
+  const CacheEntry_t *entry = &cache->entries[hash & cache->mask];
+  ++cache->lookups;
+  if (entry->hash == hash && entry->length_verdict >> 1 == length) {
+    ++cache->hits;
+    return entry->length_verdict & 1;
+  }
+  return -1;
+}
+
+/**
+ * @brief Stores the verdict of a line, replacing whatever line had the same slot
+ *
+ * @param cache the cache
+ * @param hash hashLine() of the line
+ * @param length number of bytes in the line, must not be 0
+ * @param verdict 1 if the line is a palindrome, 0 otherwise
+ */
+static inline void insertCache(Cache_t *cache, uint64_t hash, size_t length, int8_t verdict) {
+  CacheEntry_t *entry = &cache->entries[hash & cache->mask];
+  entry->hash = hash;
+  entry->length_verdict = (uint64_t)length << 1 | verdict;
+}
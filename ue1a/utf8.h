@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Invalid bytes are decoded to this value plus the byte, so they only match themselves */
+#define INVALID_UTF8_BASE 0x110000
+#define ZERO_WIDTH_JOINER 0x200D
+
+typedef struct caseFoldRange {
+  uint32_t first;
+  uint32_t last;
+  int32_t delta;
+  uint32_t stride;
+} CaseFoldRange_t;
+
+typedef struct codePointRange {
+  uint32_t first;
+  uint32_t last;
+} CodePointRange_t;
+
+bool isAscii(const char *data, size_t length);
+uint32_t decodeUtf8(const char *data, size_t end, size_t *pos);
+uint32_t decodeUtf8Backward(const char *data, size_t start, size_t *pos);
+uint32_t foldCase(uint32_t code_point);
+bool isGraphemeExtend(uint32_t code_point);
+size_t graphemeEnd(const char *line, size_t end, size_t pos);
+size_t graphemeStart(const char *line, size_t start, size_t pos);
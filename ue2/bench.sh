@@ -0,0 +1,129 @@
+#!/bin/sh
+# Author Markus Krainz
+# Date 2018
+# Checks forkFFT against a direct DFT and measures its engines.
+#
+# Usage: ./bench.sh [test|bench]
+# test transforms every signal of TEST_SIZES with every engine and compares all bins with
+# dftcheck. bench times every engine on random signals of BENCH_SIZES and reports the number of
+# processes and the bytes sent through pipes between them, checking a few bins of each result.
+# The process and shm engines fork DEPTH levels of processes (default 2).
+# Without an argument both are run. The signals are cached in $BENCH_DIR (default bench/).
+
+set -e
+
+MODE=${1:-all}
+BENCH_DIR=${BENCH_DIR:-bench}
+RUNS=${RUNS:-3}
+# largest error of a bin relative to the largest bin, enough for float
+TOLERANCE=${TOLERANCE:-1e-4}
+TEST_SIZES=${TEST_SIZES:-"1 2 3 4 5 6 7 8 12 15 16 17 97 100 128 360 1000 1024 2003 2048"}
+BENCH_SIZES=${BENCH_SIZES:-"1024 65536 1048576"}
+# levels of processes of the process and shm engines, so they fork even on one core
+DEPTH=${DEPTH:-2}
+SIGNALS="random impulse constant alternating sine chirp"
+ENGINES="process sequential shm thread"
+
+case $MODE in
+test | bench | all) ;;
+*)
+  echo "Usage: $0 [test|bench]" >&2
+  exit 1
+  ;;
+esac
+
+mkdir -p "$BENCH_DIR"
+
+# prints the name of the file with the given signal and size, generating it once
+signal_file() {
+  file="$BENCH_DIR/$1-$2.txt"
+  if [ ! -f "$file" ]; then
+    ./gensignal -k "$1" -n "$2" > "$file.tmp" || exit 1
+    mv "$file.tmp" "$file"
+  fi
+  echo "$file"
+}
+
+# prints the options of forkFFT for the given engine
+engine_options() {
+  case $1 in
+  process | shm) echo "-e $1 -d $DEPTH" ;;
+  *) echo "-e $1" ;;
+  esac
+}
+
+# prints the number of processes of the shm engine for n values, whose quiet children fork two
+# more per level until DEPTH is used up or their slice has an odd size
+shm_processes() {
+  awk -v n="$1" -v depth="$DEPTH" '
+    function count(n, depth) { return depth == 0 || n % 2 != 0 ? 1 : 1 + 2 * count(n / 2, depth - 1) }
+    BEGIN { print count(n, depth) }'
+}
+
+# prints the best wall time in seconds of RUNS runs of forkFFT with the given engine and input
+best_time() {
+  best=""
+  run=0
+  while [ $run -lt "$RUNS" ]; do
+    start=$(date +%s.%N)
+    # shellcheck disable=SC2046
+    ./forkFFT $(engine_options "$1") < "$2" > /dev/null 2>&1
+    end=$(date +%s.%N)
+    best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 == "" || t < $3) print t; else print $3 }')
+    run=$((run + 1))
+  done
+  echo "$best"
+}
+
+failures=0
+out="$BENCH_DIR/out.txt"
+log="$BENCH_DIR/log.txt"
+
+if [ "$MODE" != bench ]; then
+  for n in $TEST_SIZES; do
+    for signal in $SIGNALS; do
+      file=$(signal_file "$signal" "$n")
+      for engine in $ENGINES; do
+        # shellcheck disable=SC2046
+        if ! ./forkFFT $(engine_options "$engine") -x < "$file" > "$out" 2> "$log" ||
+          ! result=$(./dftcheck -t "$TOLERANCE" "$file" "$out"); then
+          echo "$engine $signal ${result:-forkFFT failed}" >&2
+          failures=$((failures + 1))
+        fi
+        result=""
+      done
+    done
+  done
+  echo "test: $failures failure(s) in $(echo $TEST_SIZES | wc -w) sizes x $(echo $SIGNALS | wc -w) signals x $(echo $ENGINES | wc -w) engines"
+fi
+
+if [ "$MODE" != test ]; then
+  printf "%-10s %9s %10s %9s %12s %11s\n" engine n seconds processes "pipe bytes" "rel error"
+  for n in $BENCH_SIZES; do
+    file=$(signal_file random "$n")
+    for engine in $ENGINES; do
+      # one run that is not timed, for the result and the messages of all processes
+      # shellcheck disable=SC2046
+      if ! ./forkFFT $(engine_options "$engine") -x < "$file" > "$out" 2> "$log" ||
+        ! result=$(./dftcheck -t "$TOLERANCE" -b 16 "$file" "$out"); then
+        echo "$engine random ${result:-forkFFT failed}" >&2
+        failures=$((failures + 1))
+      fi
+      seconds=$(best_time "$engine" "$file")
+      # every process of the process engine reports its pid, the other engines are quiet
+      processes=$(grep -o "My pid is: [0-9]*" "$log" | sort -u | wc -l)
+      [ "$engine" != shm ] || processes=$(shm_processes "$n")
+      [ "$processes" -gt 0 ] || processes=1
+      bytes=$(awk '/^Moved [0-9]* bytes through pipes/ { sum += $2 } END { printf "%.0f", sum }' "$log")
+      error=$(echo "$result" | sed -n 's/.*relative //p')
+      printf "%-10s %9s %10.4f %9s %12s %11s\n" "$engine" "$n" "$seconds" "$processes" "$bytes" \
+        "${error:-FAILED}"
+      result=""
+    done
+  done
+fi
+
+if [ $failures -gt 0 ]; then
+  echo "$failures transform(s) are wrong" >&2
+  exit 1
+fi
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** @defgroup Dftcheck */
+
+/** @addtogroup Dftcheck
+ * @brief Checks the output of forkFFT against a discrete Fourier transform
+ *
+ * @details Reads the real input and the complex results of a forward transform, one per line
+ * as forkFFT writes them, and calculates each bin directly in O(n) in long double. Shares no
+ * code with forkFFT, so a bug in its tables or text conversion cannot hide itself. The error
+ * is the largest absolute difference of a bin, relative to the largest bin of the reference,
+ * and the check fails if it exceeds the tolerance or the number of results is wrong.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+typedef struct values {
+  long double *re;
+  long double *im;
+  size_t size;
+  size_t capacity;
+} Values_t;
+
+static void printUsage(char *name);
+static void readValues(char *name, const char *path, bool complex, Values_t *values);
+static void referenceBin(const Values_t *input, size_t k, long double *re, long double *im);
+
+int main(int argc, char *argv[]) {
+  long double tolerance = 1e-4L;
+  size_t bins = 0;
+
+  // parse arguments
+  {
+    const char *optstring = "t:b:";
+    int c;
+
+    // getopt returns -1 if there is no more character
+    // Or it returns '?' in case of unknown option or missing option argument
+    while ((c = getopt(argc, argv, optstring)) != -1) {
+      switch (c) {
+      case 't': {
+        char *end_pointer;
+        errno = 0;
+        tolerance = strtold(optarg, &end_pointer);
+        if (errno != 0 || *end_pointer != '\0' || !(tolerance >= 0)) {
+          fprintf(stderr, "[%s, %s, %d] ERROR '-t' expects a non negative number \n", argv[0],
+                  __FILE__, __LINE__);
+          printUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      } break;
+      case 'b': {
+        char *end_pointer;
+        errno = 0;
+        bins = strtoul(optarg, &end_pointer, 10);
+        if (errno != 0 || *end_pointer != '\0' || optarg[0] == '-') {
+          fprintf(stderr, "[%s, %s, %d] ERROR '-b' expects a number \n", argv[0], __FILE__,
+                  __LINE__);
+          printUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      } break;
+      case '?': {
+        fprintf(stderr, "[%s, %s, %d] ERROR unknown option or missing argument \n", argv[0],
+                __FILE__, __LINE__);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+      } break;
+      default:
+        assert(0 && "We should never reach this if the optstring is valid");
+      }
+    }
+
+    if (argc - optind != 2) {
+      fprintf(stderr, "[%s, %s, %d] ERROR expects the input and the results \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  Values_t input = {NULL, NULL, 0, 0};
+  Values_t results = {NULL, NULL, 0, 0};
+  readValues(argv[0], argv[optind], false, &input);
+  readValues(argv[0], argv[optind + 1], true, &results);
+
+  const size_t n = input.size;
+  if (n == 0 || results.size != n) {
+    printf("n %zu: FAILED, %zu results\n", n, results.size);
+    return EXIT_FAILURE;
+  }
+
+  // every bin, or evenly spaced ones so big transforms stay O(bins * n)
+  const size_t step = bins > 0 && n > bins ? n / bins : 1;
+  long double maxError = 0;
+  long double maxMagnitude = 0;
+  size_t compared = 0;
+  for (size_t k = 0; k < n; k += step) {
+    long double re, im;
+    referenceBin(&input, k, &re, &im);
+    const long double error = hypotl(results.re[k] - re, results.im[k] - im);
+    maxError = error > maxError ? error : maxError;
+    const long double magnitude = hypotl(re, im);
+    maxMagnitude = magnitude > maxMagnitude ? magnitude : maxMagnitude;
+    ++compared;
+  }
+
+  // a signal of zeros has no largest bin to be relative to
+  const long double relative = maxError / (maxMagnitude > 0 ? maxMagnitude : 1);
+  const bool valid = relative <= tolerance;
+  printf("n %zu: %s, %zu bins, max error %Le, relative %Le\n", n, valid ? "ok" : "FAILED",
+         compared, maxError, relative);
+
+  free(input.re);
+  free(input.im);
+  free(results.re);
+  free(results.im);
+  return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Prints help including arguments of this program to stderr.
+ *
+ * @param name c_string of the name of the executable
+ */
+static void printUsage(char *name) {
+  fprintf(stderr, "\nUsage:\n\n");
+  fprintf(stderr, "%s [-t tolerance] [-b bins] input results\n", name);
+  fprintf(stderr, "\t-t largest error relative to the largest bin, default 1e-4\n");
+  fprintf(stderr, "\t-b compares only this many evenly spaced bins, default all\n");
+  fprintf(stderr, "\tinput has one real value per line, results one complex value per line\n"
+                  "\tas 're im*i'\n");
+}
+
+/**
+ * @brief Reads one value per line of a file or terminates the application
+ *
+ * @param name c_string of the name of the executable
+ * @param path the file
+ * @param complex whether lines are 're im*i', or a single real value
+ * @param values the values are appended here
+ */
+static void readValues(char *name, const char *path, bool complex, Values_t *values) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "[%s, %s, %d] ERROR cannot open %s: %s\n", name, __FILE__, __LINE__, path,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (values->size == values->capacity) {
+      values->capacity = values->capacity > 0 ? 2 * values->capacity : 1024;
+      values->re = realloc(values->re, sizeof(long double) * values->capacity);
+      values->im = realloc(values->im, sizeof(long double) * values->capacity);
+      if (values->re == NULL || values->im == NULL) {
+        fprintf(stderr, "FATAL ERROR out of memory");
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    char *end_pointer;
+    values->re[values->size] = strtold(line, &end_pointer);
+    bool valid = end_pointer != line;
+    values->im[values->size] = 0;
+    if (valid && complex) {
+      const char *imaginary = end_pointer;
+      values->im[values->size] = strtold(imaginary, &end_pointer);
+      valid = end_pointer != imaginary && strncmp(end_pointer, "*i", 2) == 0;
+      end_pointer += valid ? 2 : 0;
+    }
+    if (!valid || (*end_pointer != '\n' && *end_pointer != '\0')) {
+      fprintf(stderr, "[%s, %s, %d] ERROR invalid line in %s: %s\n", name, __FILE__, __LINE__,
+              path, line);
+      exit(EXIT_FAILURE);
+    }
+    ++values->size;
+  }
+
+  if (ferror(file)) {
+    fprintf(stderr, "[%s, %s, %d] ERROR reading %s failed\n", name, __FILE__, __LINE__, path);
+    exit(EXIT_FAILURE);
+  }
+  fclose(file);
+}
+
+/**
+ * @brief Calculates bin k of the transform of the real input directly
+ *
+ * @detail The exponent j·k is reduced modulo n before it becomes an angle, so the error does
+ * not grow with the size.
+ */
+static void referenceBin(const Values_t *input, size_t k, long double *re, long double *im) {
+  const size_t n = input->size;
+  const long double pi = acosl(-1.0L);
+  long double sumRe = 0;
+  long double sumIm = 0;
+  size_t exponent = 0;
+  for (size_t j = 0; j < n; ++j) {
+    const long double angle = -2 * pi * exponent / n;
+    sumRe += input->re[j] * cosl(angle);
+    sumIm += input->re[j] * sinl(angle);
+    exponent += k;
+    if (exponent >= n) {
+      exponent -= n;
+    }
+  }
+  *re = sumRe;
+  *im = sumIm;
+}
+
+/** @}*/
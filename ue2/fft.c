@@ -0,0 +1,1126 @@
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// there are no vector kernels for long double
+#if defined(__AVX__) && !defined(FFT_SCALAR) && !defined(REAL_LONG_DOUBLE)
+#include <immintrin.h>
+#define FFT_AVX
+#elif defined(__SSE2__) && !defined(FFT_SCALAR) && !defined(REAL_LONG_DOUBLE)
+#include <emmintrin.h>
+#define FFT_SSE2
+#endif
+
+#if defined(REAL_LONG_DOUBLE)
+/** the type the tables are computed in before they are rounded to real_t */
+typedef long double trig_t;
+#define COS cosl
+#define SIN sinl
+#else
+typedef double trig_t;
+#define COS cos
+#define SIN sin
+#endif
+
+/** Powers of two whose values take at least this many bytes are transformed with the six-step
+ * algorithm, smaller ones are fast enough in the caches as they are */
+#ifndef SIX_STEP_MIN_BYTES
+#define SIX_STEP_MIN_BYTES (1 << 23)
+#endif
+
+/** Edge of the square tiles the transposes of the six-step algorithm copy at once, 8 values of
+ * float are a cache line */
+#ifndef TRANSPOSE_TILE
+#define TRANSPOSE_TILE 8
+#endif
+
+/** @defgroup FFT */
+
+/** @addtogroup FFT
+ * @brief Calculates Fast Fourier transforms in process
+ *
+ * @details Powers of two are transformed with an iterative radix-2 Cooley-Tukey FFT. The input
+ * is brought into bit reversed order first, then combined in log2(n) passes of butterflies. The
+ * twiddle factors of each pass are stored next to each other, so the butterflies load them
+ * contiguously, two complex values at once with SSE2 or four with AVX, or half as many for
+ * double. The values are float, double or long double, as chosen at build time with real_t. All
+ * tables are computed in double, or long double for long double, and rounded only once. The
+ * twiddle factors of a pass only depend on its size, so the table for n starts with the tables
+ * for all smaller sizes. Tables are computed once per process and shared by all plans that fit
+ * into them. forkFFT keeps the biggest table in a file next to its wisdom, which later runs map
+ * instead of computing the table again.
+ * Each pass walks through all values, which is slow once they do not fit into the caches any
+ * more. Bigger powers of two are transformed with the six-step algorithm instead: the values are
+ * a matrix, whose columns are transformed, multiplied by twiddle factors, and then its rows are
+ * transformed. Columns are copied out in small tiles, so each transform works on contiguous
+ * values that fit into the caches.
+ * Sizes whose prime factors are 2, 3 and 5 are transformed by a recursive mixed radix FFT with
+ * radices 4, 2, 3 and 5. All other sizes are transformed with Bluestein's algorithm, which
+ * expresses the transform as a convolution that is calculated with power of two FFTs. So any size
+ * takes O(n log n).
+ * The input of forkFFT is real, so its transform is Hermitian: X[n - k] = conj(X[k]). Real plans
+ * pack pairs of values into one complex value and only calculate the n / 2 + 1 bins that are not
+ * redundant, with a complex transform of half the size.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+#include "fft.h"
+#include "tools.h"
+
+/**
+ * @brief Returns true if n is a power of two, including 1
+ */
+bool is_power_of_two(size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+/** Twiddle tables computed or mapped so far, they are only freed when the process ends */
+typedef struct twiddleTable {
+  size_t n;
+  const Complex_t *twiddles;
+  /** whether the table was mapped from a twiddle file, so saving it again gains nothing */
+  bool mapped;
+  struct twiddleTable *next;
+} TwiddleTable_t;
+
+static TwiddleTable_t *twiddle_cache = NULL;
+static pthread_mutex_t twiddle_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Starts every twiddle file */
+#define TWIDDLE_MAGIC "forkFFT twiddles"
+#define TWIDDLE_MAGIC_LENGTH 16
+
+/** Precedes the table of a twiddle file, which is in the byte order of the machine. It takes
+ * MEMORY_ALIGNMENT bytes, so the mapped table is aligned like an allocated one. */
+typedef struct twiddleHeader {
+  char magic[TWIDDLE_MAGIC_LENGTH];
+  /** size of one twiddle factor in bytes, to detect mismatching builds */
+  uint64_t element_size;
+  /** size of the transforms the table is for, it holds n - 1 factors */
+  uint64_t n;
+  char padding[MEMORY_ALIGNMENT - TWIDDLE_MAGIC_LENGTH - 2 * sizeof(uint64_t)];
+} TwiddleHeader_t;
+
+/**
+ * @brief Returns the twiddle factor e^(-2πik/(2 * half)), computed in trig_t and rounded once
+ */
+static inline Complex_t twiddle(size_t half, size_t k) {
+  const trig_t minusPIDividedbyHalf = -PI / half;
+  const Complex_t factor = {COS(minusPIDividedbyHalf * k), SIN(minusPIDividedbyHalf * k)};
+  return factor;
+}
+
+/**
+ * @brief Adds a table to the twiddle cache, whose mutex the caller holds
+ */
+static void insertTwiddles(TwiddleTable_t *table) {
+  // keep the list sorted by size, so the smallest table that fits is found first
+  TwiddleTable_t **position = &twiddle_cache;
+  while (*position != NULL && (*position)->n < table->n) {
+    position = &(*position)->next;
+  }
+  table->next = *position;
+  *position = table;
+}
+
+/**
+ * @brief Returns a twiddle table for transforms of size n or bigger, computing it if needed
+ *
+ * @detail The pass that combines transforms of size half into size 2 * half uses the factors
+ * e^(-2πik/(2 * half)) for k in [0, half), stored at index half - 1. Terminates the application
+ * if memory allocation fails.
+ * @param n a power of two
+ * @return n - 1 twiddle factors, at least one
+ */
+static const Complex_t *cachedTwiddles(size_t n) {
+  pthread_mutex_lock(&twiddle_cache_mutex);
+  for (TwiddleTable_t *table = twiddle_cache; table != NULL; table = table->next) {
+    if (table->n >= n) {
+      pthread_mutex_unlock(&twiddle_cache_mutex);
+      return table->twiddles;
+    }
+  }
+
+  TwiddleTable_t *table = malloc(sizeof(TwiddleTable_t));
+  Complex_t *twiddles = malloc(sizeof(Complex_t) * (n > 1 ? n - 1 : 1));
+  if (unlikely(table == NULL || twiddles == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  for (size_t half = 1; half < n; half *= 2) {
+    for (size_t k = 0; k < half; ++k) {
+      twiddles[half - 1 + k] = twiddle(half, k);
+    }
+  }
+  table->n = n;
+  table->twiddles = twiddles;
+  table->mapped = false;
+  insertTwiddles(table);
+  pthread_mutex_unlock(&twiddle_cache_mutex);
+  return twiddles;
+}
+
+/**
+ * @brief Maps the twiddle table of a file written by save_twiddles() into the twiddle cache
+ *
+ * @detail Plans whose size fits into the table use it instead of computing one, and the pages
+ * are shared with all other processes that map the file. The file is only used if it was
+ * written by a build with the same precision, and the last factor of every pass is compared
+ * with a computed one, so a foreign or damaged file is not used. Terminates the application if
+ * memory allocation fails.
+ * @param path the twiddle file
+ * @return whether the table was mapped, false if the file does not exist or is not valid
+ */
+bool map_twiddles(const char *path) {
+  const int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  TwiddleHeader_t header;
+  struct stat status;
+  const bool valid =
+      read_all(fd, &header, sizeof(header)) == 0 && fstat(fd, &status) == 0 &&
+      memcmp(header.magic, TWIDDLE_MAGIC, TWIDDLE_MAGIC_LENGTH) == 0 &&
+      header.element_size == sizeof(Complex_t) && header.n >= 2 && is_power_of_two(header.n) &&
+      header.n <= (uint64_t)status.st_size / sizeof(Complex_t) &&
+      (uint64_t)status.st_size == sizeof(header) + sizeof(Complex_t) * (header.n - 1);
+  char *data = valid ? mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  const Complex_t *twiddles = (const Complex_t *)(data + sizeof(header));
+  for (size_t half = 1; half < header.n; half *= 2) {
+    const Complex_t expected = twiddle(half, half - 1);
+    if (twiddles[2 * half - 2].re != expected.re || twiddles[2 * half - 2].im != expected.im) {
+      munmap(data, status.st_size);
+      return false;
+    }
+  }
+
+  TwiddleTable_t *table = malloc(sizeof(TwiddleTable_t));
+  if (unlikely(table == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  table->n = header.n;
+  table->twiddles = twiddles;
+  table->mapped = true;
+  pthread_mutex_lock(&twiddle_cache_mutex);
+  insertTwiddles(table);
+  pthread_mutex_unlock(&twiddle_cache_mutex);
+  return true;
+}
+
+/**
+ * @brief Writes the biggest twiddle table of the cache to a file for map_twiddles()
+ *
+ * @detail Every smaller table is the start of the biggest one, so it is the only one written.
+ * Nothing is written if the biggest table was mapped from a file or there is none. The file is
+ * replaced at once, so processes mapping it never see half of it. Terminates the application if
+ * memory allocation fails.
+ * @param path the twiddle file
+ * @return true on success, false if writing fails and errno is set
+ */
+bool save_twiddles(const char *path) {
+  // tables are never freed, so the biggest one stays valid without the mutex
+  pthread_mutex_lock(&twiddle_cache_mutex);
+  const TwiddleTable_t *biggest = twiddle_cache;
+  while (biggest != NULL && biggest->next != NULL) {
+    biggest = biggest->next;
+  }
+  pthread_mutex_unlock(&twiddle_cache_mutex);
+  if (biggest == NULL || biggest->mapped || biggest->n < 2) {
+    return true;
+  }
+
+  TwiddleHeader_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TWIDDLE_MAGIC, TWIDDLE_MAGIC_LENGTH);
+  header.element_size = sizeof(Complex_t);
+  header.n = biggest->n;
+  char *temporary;
+  FILE *file = create_replacement(path, &temporary);
+  if (file == NULL) {
+    return false;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(biggest->twiddles, sizeof(Complex_t), biggest->n - 1, file);
+  return replace_file(file, temporary, path);
+}
+
+/**
+ * @brief Allocates n complex values or terminates the application
+ */
+static Complex_t *allocComplex(size_t n) {
+  return alloc_aligned(sizeof(Complex_t) * n);
+}
+
+/** Work buffers of a plan that no transform is using at the moment. Each transform takes one
+ * and gives it back, so threads sharing a plan never share a buffer, and buffers are only
+ * allocated for the first transforms that run at the same time. */
+typedef struct scratchPool {
+  pthread_mutex_t mutex;
+  /** complex values per buffer */
+  size_t size;
+  Complex_t **spare;
+  size_t count;
+  size_t capacity;
+} ScratchPool_t;
+
+/**
+ * @brief Gives a plan its first work buffer of size complex values
+ *
+ * @detail Terminates the application if memory allocation fails.
+ */
+static void initScratch(Plan_t *plan, size_t size) {
+  ScratchPool_t *pool = malloc(sizeof(ScratchPool_t));
+  if (unlikely(pool == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  pthread_mutex_init(&pool->mutex, NULL);
+  pool->size = size;
+  pool->capacity = 4;
+  pool->spare = malloc(sizeof(Complex_t *) * pool->capacity);
+  if (unlikely(pool->spare == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  pool->spare[0] = allocComplex(size);
+  pool->count = 1;
+  plan->scratch = pool;
+}
+
+/**
+ * @brief Takes a work buffer of the plan, allocating one if all are in use
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @return plan->scratch->size complex values, to be given back with releaseScratch()
+ */
+static Complex_t *takeScratch(const Plan_t *plan) {
+  ScratchPool_t *pool = plan->scratch;
+  pthread_mutex_lock(&pool->mutex);
+  Complex_t *work = pool->count > 0 ? pool->spare[--pool->count] : NULL;
+  pthread_mutex_unlock(&pool->mutex);
+  return work != NULL ? work : allocComplex(pool->size);
+}
+
+/**
+ * @brief Gives a work buffer back to the plan, for the next transform
+ *
+ * @detail Terminates the application if memory allocation fails.
+ */
+static void releaseScratch(const Plan_t *plan, Complex_t *work) {
+  ScratchPool_t *pool = plan->scratch;
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->count == pool->capacity) {
+    pool->capacity = pool->capacity > 0 ? 2 * pool->capacity : 4;
+    pool->spare = realloc(pool->spare, sizeof(Complex_t *) * pool->capacity);
+    if (unlikely(pool->spare == NULL)) {
+      // out of memory
+      exit(EXIT_FAILURE);
+    }
+  }
+  pool->spare[pool->count++] = work;
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Frees the work buffers of a plan, which all have to be given back
+ */
+static void freeScratch(Plan_t *plan) {
+  ScratchPool_t *pool = plan->scratch;
+  if (pool == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < pool->count; ++i) {
+    free(pool->spare[i]);
+  }
+  free(pool->spare);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool);
+  plan->scratch = NULL;
+}
+
+/**
+ * @brief Sets roots to e^(-2πik/n) for k in [0, n)
+ */
+static void computeRoots(Complex_t *roots, size_t n) {
+  const trig_t minus2PIDividedbyN = -2 * PI / n;
+  for (size_t k = 0; k < n; ++k) {
+    roots[k].re = COS(minus2PIDividedbyN * k);
+    roots[k].im = SIN(minus2PIDividedbyN * k);
+  }
+}
+
+/**
+ * @brief Prepares the six-step transform of a power of two
+ *
+ * @detail The matrix has at least as many columns as rows. The twiddle factors between the
+ * column and the row transforms are taken from the last pass of the radix-2 table, which holds
+ * e^(-2πik/n) for k in [0, n / 2), and e^(-2πi(k + n / 2)/n) = -e^(-2πik/n).
+ * Terminates the application if memory allocation fails.
+ * @param plan a plan of kind PLAN_RADIX2 with its twiddles, which becomes PLAN_SIX_STEP
+ */
+static void initSixStep(Plan_t *plan) {
+  const size_t n = plan->n;
+  plan->kind = PLAN_SIX_STEP;
+  plan->columns = 1;
+  while (plan->columns * plan->columns < n) {
+    plan->columns *= 2;
+  }
+  plan->rows = n / plan->columns;
+
+  init_arena(&plan->memory, ARENA_BLOCK_SIZE(sizeof(Complex_t) * n));
+  plan->matrix_twiddles = alloc_arena(&plan->memory, sizeof(Complex_t) * n);
+  const Complex_t *roots = plan->twiddles + n / 2 - 1;
+  for (size_t c = 0; c < plan->columns; ++c) {
+    for (size_t k = 0; k < plan->rows; ++k) {
+      const size_t exponent = c * k;
+      Complex_t factor = roots[exponent % (n / 2)];
+      if (exponent >= n / 2) {
+        factor.re = -factor.re;
+        factor.im = -factor.im;
+      }
+      plan->matrix_twiddles[c * plan->rows + k] = factor;
+    }
+  }
+  initScratch(plan, n);
+}
+
+/**
+ * @brief Sets the size of a plan and all of its tables to none
+ */
+static void initEmptyPlan(Plan_t *plan, size_t n) {
+  plan->n = n;
+  plan->twiddles = NULL;
+  plan->roots = NULL;
+  plan->factor_count = 0;
+  plan->m = 0;
+  plan->chirp = NULL;
+  plan->chirp_spectrum = NULL;
+  plan->memory.data = NULL;
+  plan->scratch = NULL;
+
+  plan->rows = 0;
+  plan->columns = 0;
+  plan->matrix_twiddles = NULL;
+}
+
+/**
+ * @brief Prepares everything needed for transforms of size n
+ *
+ * @detail For powers of two only the twiddle factors are needed, and they are only computed the
+ * first time a size, or a bigger one, is planned. Other sizes are factored into the radices of
+ * the mixed radix transform, or get Bluestein's chirp and its transform. All tables of a plan
+ * are blocks of one arena.
+ * Terminates the application if memory allocation fails.
+ * @param plan The plan to be initialized
+ * @param n size of the transforms, at least 1
+ */
+void init_plan(Plan_t *plan, size_t n) {
+  init_plan_radix(plan, n, 2);
+}
+
+/**
+ * @brief Prepares only what combine_radix2() needs to combine slices of a transform of size n
+ *
+ * @detail The engines that split the transform into slices only combine them with the plan of
+ * the whole size, they never execute it. So a power of two only gets the cached twiddle factors,
+ * without the tables of the six-step algorithm, and other sizes only get their roots, without
+ * the tables of the mixed radix or Bluestein transform. The plan cannot be executed.
+ * Terminates the application if memory allocation fails.
+ * @param plan The plan to be initialized
+ * @param n size of the whole transform, at least 1
+ */
+void init_combine_plan(Plan_t *plan, size_t n) {
+  initEmptyPlan(plan, n);
+  plan->kind = PLAN_COMBINE;
+  if (is_power_of_two(n)) {
+    plan->twiddles = cachedTwiddles(n);
+    return;
+  }
+  init_arena(&plan->memory, ARENA_BLOCK_SIZE(sizeof(Complex_t) * n));
+  plan->roots = alloc_arena(&plan->memory, sizeof(Complex_t) * n);
+  computeRoots(plan->roots, n);
+}
+
+/**
+ * @brief Prepares everything needed for transforms of size n, with the given passes
+ *
+ * @detail Like init_plan(), but powers of two can be planned as mixed radix transforms, whose
+ * radix-4 passes need fewer operations but do not have vector kernels. Which one is faster
+ * depends on the machine and the size.
+ * @param plan The plan to be initialized
+ * @param n size of the transforms, at least 1
+ * @param radix 4 for radix-4 passes for powers of two, 2 for radix-2 passes. Other sizes are
+ * not affected.
+ */
+void init_plan_radix(Plan_t *plan, size_t n, size_t radix) {
+  initEmptyPlan(plan, n);
+
+  if (is_power_of_two(n) && (radix != 4 || n < 4)) {
+    plan->kind = PLAN_RADIX2;
+    plan->twiddles = cachedTwiddles(n);
+    if (sizeof(Complex_t) * n >= SIX_STEP_MIN_BYTES) {
+      initSixStep(plan);
+    }
+    return;
+  }
+
+  // radix 4 first, as it needs the fewest operations per value
+  static const size_t radices[] = {4, 2, 3, 5};
+  size_t left = n;
+  for (size_t i = 0; i < sizeof(radices) / sizeof(radices[0]); ++i) {
+    while (left % radices[i] == 0) {
+      plan->factors[plan->factor_count++] = radices[i];
+      left /= radices[i];
+    }
+  }
+  if (left == 1) {
+    plan->kind = PLAN_MIXED_RADIX;
+    plan->twiddles = NULL;
+    init_arena(&plan->memory, ARENA_BLOCK_SIZE(sizeof(Complex_t) * n));
+    plan->roots = alloc_arena(&plan->memory, sizeof(Complex_t) * n);
+    computeRoots(plan->roots, n);
+    // the values are copied out, as the transform is not in place
+    initScratch(plan, n);
+    return;
+  }
+
+  // X[k] = chirp[k] · sum_j (x[j] · chirp[j]) · conj(chirp[k - j]), as k·j = (k² + j² - (k-j)²) / 2
+  plan->kind = PLAN_BLUESTEIN;
+  plan->m = 1;
+  while (plan->m < 2 * n - 1) {
+    plan->m *= 2;
+  }
+  plan->twiddles = cachedTwiddles(plan->m);
+  init_arena(&plan->memory, 2 * ARENA_BLOCK_SIZE(sizeof(Complex_t) * n) +
+                                ARENA_BLOCK_SIZE(sizeof(Complex_t) * plan->m));
+  plan->roots = alloc_arena(&plan->memory, sizeof(Complex_t) * n);
+  computeRoots(plan->roots, n);
+
+  plan->chirp = alloc_arena(&plan->memory, sizeof(Complex_t) * n);
+  for (size_t k = 0; k < n; ++k) {
+    // k² modulo 2n keeps the angle small, so it stays exact for big k
+    const trig_t angle = -PI * (trig_t)((unsigned long long)k * k % (2 * n)) / n;
+    plan->chirp[k].re = COS(angle);
+    plan->chirp[k].im = SIN(angle);
+  }
+
+  plan->chirp_spectrum = alloc_arena(&plan->memory, sizeof(Complex_t) * plan->m);
+  for (size_t k = 0; k < plan->m; ++k) {
+    plan->chirp_spectrum[k].re = 0;
+    plan->chirp_spectrum[k].im = 0;
+  }
+  for (size_t k = 0; k < n; ++k) {
+    const Complex_t conjugated = {plan->chirp[k].re / plan->m, -plan->chirp[k].im / plan->m};
+    plan->chirp_spectrum[k] = conjugated;
+    if (k > 0) {
+      plan->chirp_spectrum[plan->m - k] = conjugated;
+    }
+  }
+  transform_radix2(plan->chirp_spectrum, plan->m, plan);
+  initScratch(plan, plan->m);
+}
+
+/**
+ * @brief Reorders data so that element i is swapped with the element at bit reversed i
+ */
+static void bitReverse(Complex_t *data, size_t n) {
+  for (size_t i = 1, j = 0; i < n; ++i) {
+    // increment j in bit reversed order
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j |= bit;
+
+    if (i < j) {
+      const Complex_t tmp = data[i];
+      data[i] = data[j];
+      data[j] = tmp;
+    }
+  }
+}
+
+/**
+ * @brief Does half butterflies: odd[k] *= twiddles[k], then even[k], odd[k] = even[k] ± odd[k]
+ *
+ * @param even the transform of the even elements, replaced by the first half of the result
+ * @param odd the transform of the odd elements, replaced by the second half of the result
+ * @param twiddles the twiddle factors of the pass
+ * @param half number of butterflies
+ */
+static inline void butterflies(Complex_t *even, Complex_t *odd, const Complex_t *twiddles,
+                               size_t half) {
+  size_t k = 0;
+#if defined(FFT_AVX) && defined(REAL_DOUBLE)
+  for (; k + 2 <= half; k += 2) {
+    const __m256d a = _mm256_loadu_pd(&odd[k].re);
+    const __m256d w = _mm256_loadu_pd(&twiddles[k].re);
+    const __m256d e = _mm256_loadu_pd(&even[k].re);
+
+    // the same as for float, for two complex values at once
+    const __m256d swapped = _mm256_permute_pd(a, 0x5);
+    const __m256d product = _mm256_addsub_pd(_mm256_mul_pd(a, _mm256_movedup_pd(w)),
+                                             _mm256_mul_pd(swapped, _mm256_permute_pd(w, 0xf)));
+
+    _mm256_storeu_pd(&even[k].re, _mm256_add_pd(e, product));
+    _mm256_storeu_pd(&odd[k].re, _mm256_sub_pd(e, product));
+  }
+#elif defined(FFT_AVX)
+  for (; k + 4 <= half; k += 4) {
+    const __m256 a = _mm256_loadu_ps(&odd[k].re);
+    const __m256 w = _mm256_loadu_ps(&twiddles[k].re);
+    const __m256 e = _mm256_loadu_ps(&even[k].re);
+
+    // (a.re·w.re - a.im·w.im, a.im·w.re + a.re·w.im) for four complex values at once
+    const __m256 swapped = _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1));
+    const __m256 product = _mm256_addsub_ps(_mm256_mul_ps(a, _mm256_moveldup_ps(w)),
+                                            _mm256_mul_ps(swapped, _mm256_movehdup_ps(w)));
+
+    _mm256_storeu_ps(&even[k].re, _mm256_add_ps(e, product));
+    _mm256_storeu_ps(&odd[k].re, _mm256_sub_ps(e, product));
+  }
+#elif defined(FFT_SSE2) && defined(REAL_DOUBLE)
+  // flips the sign of the real part
+  const __m128d negate_real = _mm_set_pd(0.0, -0.0);
+  for (; k < half; ++k) {
+    const __m128d a = _mm_loadu_pd(&odd[k].re);
+    const __m128d w = _mm_loadu_pd(&twiddles[k].re);
+    const __m128d e = _mm_loadu_pd(&even[k].re);
+
+    // the same as for float, for one complex value at once
+    const __m128d swapped = _mm_shuffle_pd(a, a, 1);
+    const __m128d product =
+        _mm_add_pd(_mm_mul_pd(a, _mm_unpacklo_pd(w, w)),
+                   _mm_xor_pd(_mm_mul_pd(swapped, _mm_unpackhi_pd(w, w)), negate_real));
+
+    _mm_storeu_pd(&even[k].re, _mm_add_pd(e, product));
+    _mm_storeu_pd(&odd[k].re, _mm_sub_pd(e, product));
+  }
+#elif defined(FFT_SSE2)
+  // flips the sign of the real parts
+  const __m128 negate_real = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+  for (; k + 2 <= half; k += 2) {
+    const __m128 a = _mm_loadu_ps(&odd[k].re);
+    const __m128 w = _mm_loadu_ps(&twiddles[k].re);
+    const __m128 e = _mm_loadu_ps(&even[k].re);
+
+    // (a.re·w.re - a.im·w.im, a.im·w.re + a.re·w.im) for two complex values at once
+    const __m128 w_re = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+    const __m128 w_im = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+    const __m128 swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+    const __m128 product = _mm_add_ps(
+        _mm_mul_ps(a, w_re), _mm_xor_ps(_mm_mul_ps(swapped, w_im), negate_real));
+
+    _mm_storeu_ps(&even[k].re, _mm_add_ps(e, product));
+    _mm_storeu_ps(&odd[k].re, _mm_sub_ps(e, product));
+  }
+#endif
+  for (; k < half; ++k) {
+    const Complex_t factor = twiddles[k];
+    const Complex_t e = even[k];
+    const Complex_t o = odd[k];
+
+    //(a[r]+a[i])(c[r]+c[i]) = a[r]·c[r] - a[i]·c[i] + i·(a[r]·c[i]+a[i]·c[r]);
+    const real_t rightSide = factor.re * o.re - factor.im * o.im;
+    const real_t rightSideImaginary = factor.re * o.im + factor.im * o.re;
+
+    even[k].re = e.re + rightSide;
+    even[k].im = e.im + rightSideImaginary;
+    odd[k].re = e.re - rightSide;
+    odd[k].im = e.im - rightSideImaginary;
+  }
+}
+
+/**
+ * @brief Transforms data in place with the twiddle factors of a plan for the same or a bigger size
+ *
+ * @param data n complex values, replaced by their discrete Fourier transform
+ * @param n size of the transform, a power of two
+ * @param plan a plan for a power of two >= n
+ */
+void transform_radix2(Complex_t *data, size_t n, const Plan_t *plan) {
+  bitReverse(data, n);
+
+  // combine pairs of transforms of size half into transforms of size 2 * half
+  for (size_t half = 1; half < n; half *= 2) {
+    const Complex_t *twiddles = plan->twiddles + half - 1;
+    for (size_t start = 0; start < n; start += 2 * half) {
+      butterflies(data + start, data + start + half, twiddles, half);
+    }
+  }
+}
+
+/**
+ * @brief Combines the transforms of the even and odd elements into the whole transform
+ *
+ * @detail The last pass of transform_radix2(), for callers that calculated the two halves
+ * separately, e.g. in different processes or threads.
+ * @param data the transform of the even elements followed by the one of the odd elements, n / 2
+ * values each. It is replaced by the transform of size n.
+ * @param n size of the transform, even
+ * @param plan a plan for a power of two >= n if n is a power of two, otherwise for a multiple
+ * of n
+ */
+void combine_radix2(Complex_t *data, size_t n, const Plan_t *plan) {
+  const size_t half = n / 2;
+  if (plan->roots == NULL) {
+    butterflies(data, data + half, plan->twiddles + half - 1, half);
+    return;
+  }
+
+  const size_t stride = plan->n / n;
+  for (size_t k = 0; k < half; ++k) {
+    const Complex_t factor = plan->roots[k * stride];
+    const Complex_t e = data[k];
+    const Complex_t o = data[k + half];
+    const Complex_t product = {factor.re * o.re - factor.im * o.im,
+                               factor.re * o.im + factor.im * o.re};
+    data[k].re = e.re + product.re;
+    data[k].im = e.im + product.im;
+    data[k + half].re = e.re - product.re;
+    data[k + half].im = e.im - product.im;
+  }
+}
+
+/**
+ * @brief Returns a · b
+ */
+static inline Complex_t multiply(Complex_t a, Complex_t b) {
+  const Complex_t product = {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+  return product;
+}
+
+/**
+ * @brief Transforms n values of in, taken every inStride, into out[0..n) with a mixed radix FFT
+ *
+ * @detail Splits the input into factors[0] interleaved parts, transforms them recursively next to
+ * each other in out, and combines them with one butterfly of size factors[0] per output index.
+ * @param out where the transform is stored
+ * @param in the input
+ * @param inStride distance between the values of this transform in in
+ * @param n size of this transform, the product of the factors
+ * @param factors the radices of this and all smaller transforms
+ * @param plan the plan of the whole transform, for its roots
+ */
+static void mixedRadix(Complex_t *out, const Complex_t *in, size_t inStride, size_t n,
+                       const size_t *factors, const Plan_t *plan) {
+  const size_t radix = factors[0];
+  const size_t m = n / radix;
+
+  if (m == 1) {
+    for (size_t q = 0; q < radix; ++q) {
+      out[q] = in[q * inStride];
+    }
+  } else {
+    for (size_t q = 0; q < radix; ++q) {
+      mixedRadix(out + q * m, in + q * inStride, inStride * radix, m, factors + 1, plan);
+    }
+  }
+
+  // e^(-2πi/n) is every (N/n)th root of the whole transform of size N
+  const Complex_t *roots = plan->roots;
+  const size_t stride = plan->n / n;
+  const real_t sin60 = 0.866025403784438646763723170752936183L;
+  for (size_t k = 0; k < m; ++k) {
+    Complex_t y[5];
+    y[0] = out[k];
+    for (size_t q = 1; q < radix; ++q) {
+      y[q] = multiply(out[k + q * m], roots[q * k * stride]);
+    }
+
+    switch (radix) {
+    case 2: {
+      out[k].re = y[0].re + y[1].re;
+      out[k].im = y[0].im + y[1].im;
+      out[k + m].re = y[0].re - y[1].re;
+      out[k + m].im = y[0].im - y[1].im;
+    } break;
+    case 3: {
+      // X1, X2 = y0 - (y1 + y2) / 2 ∓ i·sin(60°)·(y1 - y2)
+      const Complex_t sum = {y[1].re + y[2].re, y[1].im + y[2].im};
+      const Complex_t rotated = {sin60 * (y[1].im - y[2].im), -sin60 * (y[1].re - y[2].re)};
+      out[k].re = y[0].re + sum.re;
+      out[k].im = y[0].im + sum.im;
+      out[k + m].re = y[0].re - sum.re / 2 + rotated.re;
+      out[k + m].im = y[0].im - sum.im / 2 + rotated.im;
+      out[k + 2 * m].re = y[0].re - sum.re / 2 - rotated.re;
+      out[k + 2 * m].im = y[0].im - sum.im / 2 - rotated.im;
+    } break;
+    case 4: {
+      // X1, X3 = (y0 - y2) ∓ i·(y1 - y3)
+      const Complex_t sum02 = {y[0].re + y[2].re, y[0].im + y[2].im};
+      const Complex_t diff02 = {y[0].re - y[2].re, y[0].im - y[2].im};
+      const Complex_t sum13 = {y[1].re + y[3].re, y[1].im + y[3].im};
+      const Complex_t diff13 = {y[1].re - y[3].re, y[1].im - y[3].im};
+      out[k].re = sum02.re + sum13.re;
+      out[k].im = sum02.im + sum13.im;
+      out[k + m].re = diff02.re + diff13.im;
+      out[k + m].im = diff02.im - diff13.re;
+      out[k + 2 * m].re = sum02.re - sum13.re;
+      out[k + 2 * m].im = sum02.im - sum13.im;
+      out[k + 3 * m].re = diff02.re - diff13.im;
+      out[k + 3 * m].im = diff02.im + diff13.re;
+    } break;
+    default: {
+      // a direct DFT of size 5 with the fifth roots of unity
+      for (size_t q = 0; q < radix; ++q) {
+        Complex_t sum = y[0];
+        for (size_t j = 1; j < radix; ++j) {
+          const Complex_t term = multiply(y[j], roots[(j * q % radix) * (plan->n / radix)]);
+          sum.re += term.re;
+          sum.im += term.im;
+        }
+        out[k + q * m] = sum;
+      }
+    } break;
+    }
+  }
+}
+
+/**
+ * @brief Transforms data in place with Bluestein's algorithm
+ *
+ * @detail Convolves the input, multiplied by the chirp, with the conjugated chirp through power
+ * of two transforms of size m. The inverse transform is a forward one of the conjugate.
+ */
+static void bluestein(const Plan_t *plan, Complex_t *data) {
+  const size_t n = plan->n;
+  const size_t m = plan->m;
+  Complex_t *work = takeScratch(plan);
+  for (size_t k = 0; k < n; ++k) {
+    work[k] = multiply(data[k], plan->chirp[k]);
+  }
+  for (size_t k = n; k < m; ++k) {
+    work[k].re = 0;
+    work[k].im = 0;
+  }
+
+  transform_radix2(work, m, plan);
+  for (size_t k = 0; k < m; ++k) {
+    work[k] = multiply(work[k], plan->chirp_spectrum[k]);
+    work[k].im = -work[k].im;
+  }
+  transform_radix2(work, m, plan);
+
+  for (size_t k = 0; k < n; ++k) {
+    const Complex_t convolved = {work[k].re, -work[k].im};
+    data[k] = multiply(convolved, plan->chirp[k]);
+  }
+  releaseScratch(plan, work);
+}
+
+/**
+ * @brief Stores the transpose of in, a matrix of rows x columns values, in out
+ *
+ * @detail Copies square tiles, so both matrices are only touched a few cache lines at a time.
+ */
+static void transpose(Complex_t *out, const Complex_t *in, size_t rows, size_t columns) {
+  for (size_t r0 = 0; r0 < rows; r0 += TRANSPOSE_TILE) {
+    for (size_t c0 = 0; c0 < columns; c0 += TRANSPOSE_TILE) {
+      for (size_t r = r0; r < r0 + TRANSPOSE_TILE && r < rows; ++r) {
+        for (size_t c = c0; c < c0 + TRANSPOSE_TILE && c < columns; ++c) {
+          out[c * rows + r] = in[r * columns + c];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Transforms data in place with the six-step algorithm
+ *
+ * @detail With n = rows · columns and the input x[c + columns · r] as a matrix of rows x columns
+ * values: X[k + rows · l] = sum_c e^(-2πi·c·l/columns) · e^(-2πi·c·k/n) ·
+ * sum_r x[c + columns · r] · e^(-2πi·r·k/rows). So the columns are transformed, multiplied by
+ * the twiddle factors and the rows are transformed. A few columns at a time are copied to
+ * contiguous memory and back, so each read cache line is used up, and the last transpose stores
+ * the result in the right order. Terminates the application if memory allocation fails.
+ */
+static void sixStep(const Plan_t *plan, Complex_t *data) {
+  const size_t rows = plan->rows;
+  const size_t columns = plan->columns;
+  Complex_t *work = takeScratch(plan);
+
+  for (size_t c0 = 0; c0 < columns; c0 += TRANSPOSE_TILE) {
+    // gather a few columns at once, so every cache line of data that is read is used up
+    const size_t tile = columns - c0 < TRANSPOSE_TILE ? columns - c0 : TRANSPOSE_TILE;
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < tile; ++c) {
+        work[c * rows + r] = data[r * columns + c0 + c];
+      }
+    }
+    for (size_t c = 0; c < tile; ++c) {
+      Complex_t *column = work + c * rows;
+      transform_radix2(column, rows, plan);
+      const Complex_t *twiddles = plan->matrix_twiddles + (c0 + c) * rows;
+      for (size_t k = 0; k < rows; ++k) {
+        column[k] = multiply(column[k], twiddles[k]);
+      }
+    }
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < tile; ++c) {
+        data[r * columns + c0 + c] = work[c * rows + r];
+      }
+    }
+  }
+
+  for (size_t r = 0; r < rows; ++r) {
+    transform_radix2(data + r * columns, columns, plan);
+  }
+
+  transpose(work, data, rows, columns);
+  memcpy(data, work, sizeof(Complex_t) * plan->n);
+  releaseScratch(plan, work);
+}
+
+/**
+ * @brief Transforms data in place
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @param plan a plan for the size of data
+ * @param data plan->n complex values, replaced by their discrete Fourier transform
+ */
+void execute_plan(const Plan_t *plan, Complex_t *data) {
+  switch (plan->kind) {
+  case PLAN_RADIX2:
+    transform_radix2(data, plan->n, plan);
+    return;
+  case PLAN_SIX_STEP:
+    sixStep(plan, data);
+    return;
+  case PLAN_MIXED_RADIX: {
+    Complex_t *in = takeScratch(plan);
+    memcpy(in, data, sizeof(Complex_t) * plan->n);
+    mixedRadix(data, in, 1, plan->n, plan->factors, plan);
+    releaseScratch(plan, in);
+  }
+    return;
+  case PLAN_BLUESTEIN:
+    bluestein(plan, data);
+    return;
+  case PLAN_COMBINE:
+    assert(0 && "A plan for combine_radix2() cannot transform");
+    return;
+  }
+}
+
+/**
+ * @brief Transforms data in place with the inverse transform
+ *
+ * @detail x[t] = 1/n · sum_k X[k] · e^(2πikt/n), which is the conjugate of the forward transform
+ * of the conjugate, divided by n. Terminates the application if memory allocation fails.
+ * @param plan a plan for the size of data
+ * @param data plan->n complex values, replaced by their inverse discrete Fourier transform
+ */
+void execute_inverse_plan(const Plan_t *plan, Complex_t *data) {
+  const size_t n = plan->n;
+  for (size_t k = 0; k < n; ++k) {
+    data[k].im = -data[k].im;
+  }
+  execute_plan(plan, data);
+  for (size_t k = 0; k < n; ++k) {
+    data[k].re = data[k].re / n;
+    data[k].im = -data[k].im / n;
+  }
+}
+
+/**
+ * @brief Prepares transforms of n real values
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @param plan The plan to be initialized
+ * @param n number of real values, at least 1
+ */
+void init_real_plan(RealPlan_t *plan, size_t n) {
+  init_real_plan_radix(plan, n, 2);
+}
+
+/**
+ * @brief Prepares transforms of n real values, with the given passes
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @param plan The plan to be initialized
+ * @param n number of real values, at least 1
+ * @param radix the radix of the passes of the complex transform, see init_plan_radix()
+ */
+void init_real_plan_radix(RealPlan_t *plan, size_t n, size_t radix) {
+  plan->n = n;
+  if (n % 2 != 0) {
+    // there are no pairs to pack
+    init_plan_radix(&plan->half, n, radix);
+    plan->roots = NULL;
+    return;
+  }
+
+  init_plan_radix(&plan->half, n / 2, radix);
+  const size_t count = n / 4 + 1;
+  plan->roots = allocComplex(count);
+  const trig_t minus2PIDividedbyN = -2 * PI / n;
+  for (size_t k = 0; k < count; ++k) {
+    plan->roots[k].re = COS(minus2PIDividedbyN * k);
+    plan->roots[k].im = SIN(minus2PIDividedbyN * k);
+  }
+}
+
+/**
+ * @brief Transforms n real values into the n / 2 + 1 bins that are not redundant
+ *
+ * @detail The even values become the real parts and the odd values the imaginary parts of n / 2
+ * complex values, which are transformed in place in output. Their transforms E and O are
+ * separated again with the symmetry of real transforms, and combined like in a radix-2 pass:
+ * X[k] = E[k] + e^(-2πik/n) · O[k] and X[n / 2 - k] = conj(E[k] - e^(-2πik/n) · O[k]).
+ * Terminates the application if memory allocation fails.
+ * @param plan a plan for n
+ * @param input the real values, input[i * stride] for i in [0, n)
+ * @param stride distance between the values
+ * @param output room for n complex values, of which the first n / 2 + 1 are set to the bins
+ */
+void execute_real_plan(const RealPlan_t *plan, const real_t *input, size_t stride,
+                       Complex_t *output) {
+  const size_t n = plan->n;
+  if (n % 2 != 0) {
+    for (size_t i = 0; i < n; ++i) {
+      output[i].re = input[i * stride];
+      output[i].im = 0;
+    }
+    execute_plan(&plan->half, output);
+    return;
+  }
+
+  const size_t half = n / 2;
+  for (size_t i = 0; i < half; ++i) {
+    output[i].re = input[2 * i * stride];
+    output[i].im = input[(2 * i + 1) * stride];
+  }
+  execute_plan(&plan->half, output);
+
+  // the transform of the packed values Z is E + i·O, with E[k] = (Z[k] + conj(Z[half - k])) / 2
+  // and O[k] = (Z[k] - conj(Z[half - k])) / 2i
+  const Complex_t z0 = output[0];
+  output[0].re = z0.re + z0.im;
+  output[0].im = 0;
+  output[half].re = z0.re - z0.im;
+  output[half].im = 0;
+  for (size_t k = 1; k <= half / 2; ++k) {
+    const Complex_t a = output[k];
+    const Complex_t b = output[half - k];
+    const Complex_t e = {(a.re + b.re) / 2, (a.im - b.im) / 2};
+    const Complex_t o = {(a.im + b.im) / 2, (b.re - a.re) / 2};
+    const Complex_t t = multiply(plan->roots[k], o);
+    output[k].re = e.re + t.re;
+    output[k].im = e.im + t.im;
+    output[half - k].re = e.re - t.re;
+    output[half - k].im = t.im - e.im;
+  }
+}
+
+/**
+ * @brief Combines the bins of the even and odd values into the bins of all n values
+ *
+ * @detail Like combine_radix2(), but only for the bins that are not redundant.
+ * @param plan a plan for n, which is even
+ * @param even the n / 4 + 1 bins of the transform of the even values
+ * @param odd the n / 4 + 1 bins of the transform of the odd values
+ * @param output room for n / 2 + 1 bins
+ */
+void combine_real(const RealPlan_t *plan, const Complex_t *even, const Complex_t *odd,
+                  Complex_t *output) {
+  const size_t half = plan->n / 2;
+  for (size_t k = 0; k <= half / 2; ++k) {
+    const Complex_t t = multiply(plan->roots[k], odd[k]);
+    output[k].re = even[k].re + t.re;
+    output[k].im = even[k].im + t.im;
+    // e^(-2πi(half - k)/n) = -conj(e^(-2πik/n)) and E, O are Hermitian with period half
+    output[half - k].re = even[k].re - t.re;
+    output[half - k].im = t.im - even[k].im;
+  }
+  output[half].re = even[0].re - odd[0].re;
+  output[half].im = 0;
+}
+
+/**
+ * @brief Restores the redundant bins of a real transform
+ *
+ * @param data a transform of size n, of which the first n / 2 + 1 bins are set. The others are
+ * set to X[n - k] = conj(X[k]).
+ * @param n size of the transform
+ */
+void expand_spectrum(Complex_t *data, size_t n) {
+  for (size_t k = n / 2 + 1; k < n; ++k) {
+    data[k].re = data[n - k].re;
+    data[k].im = -data[n - k].im;
+  }
+}
+
+/**
+ * @brief Frees a real plan
+ *
+ * @detail After this function has been called do not reuse the plan.
+ * @param plan The plan
+ */
+void free_real_plan(RealPlan_t *plan) {
+  free_plan(&plan->half);
+  free(plan->roots);
+  plan->roots = NULL;
+  plan->n = 0;
+}
+
+/**
+ * @brief Computes the coefficients of a window function
+ *
+ * @detail The windows are periodic, i.e. the first n values of a window of size n + 1, so
+ * frames overlapping by half sum to a constant with the Hann window.
+ * @param window is set to the n coefficients
+ * @param n size of the window
+ * @param type the window function
+ */
+void compute_window(real_t *window, size_t n, Window_t type) {
+  const trig_t twoPIDividedbyN = 2 * PI / n;
+  for (size_t k = 0; k < n; ++k) {
+    const trig_t c1 = COS(twoPIDividedbyN * k);
+    switch (type) {
+    case WINDOW_HANN:
+      window[k] = 0.5 - 0.5 * c1;
+      break;
+    case WINDOW_HAMMING:
+      window[k] = 0.54 - 0.46 * c1;
+      break;
+    case WINDOW_BLACKMAN:
+      window[k] = 0.42 - 0.5 * c1 + 0.08 * COS(2 * twoPIDividedbyN * k);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Frees a plan
+ *
+ * @detail After this function has been called do not reuse the plan.
+ * @param plan The plan
+ */
+void free_plan(Plan_t *plan) {
+  // the twiddle factors stay cached for the next plan
+  plan->twiddles = NULL;
+  free_arena(&plan->memory);
+  freeScratch(plan);
+  plan->roots = NULL;
+  plan->chirp = NULL;
+  plan->chirp_spectrum = NULL;
+  plan->matrix_twiddles = NULL;
+  plan->n = 0;
+}
+
+/** @}*/
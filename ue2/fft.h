@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "tools.h"
+
+typedef struct complex {
+  real_t re;
+  real_t im;
+} Complex_t;
+
+/** Radices of the mixed radix transform, enough for any size_t */
+#define MAX_FACTORS 64
+
+typedef enum planKind {
+  /** n is a power of two */
+  PLAN_RADIX2,
+  /** n is a power of two too big for the caches, it is transformed as a matrix of small ones */
+  PLAN_SIX_STEP,
+  /** n only has the prime factors 2, 3 and 5 */
+  PLAN_MIXED_RADIX,
+  /** n has a bigger prime factor, it is transformed with a power of two convolution */
+  PLAN_BLUESTEIN,
+  /** only combines the halves of slices with combine_radix2(), see init_combine_plan() */
+  PLAN_COMBINE
+} PlanKind_t;
+
+struct scratchPool;
+
+/** Everything about a transform size that can be computed before seeing any data.
+ * Its tables are only read while transforming, and each transform takes its own work buffer,
+ * so threads can share it. */
+typedef struct plan {
+  size_t n;
+  PlanKind_t kind;
+  /** e^(-2πik/(2 * half)) for k in [0, half) at index half - 1, for every pass of size half of
+   * the power of two transform, which is n or Bluestein's convolution size */
+  const Complex_t *twiddles;
+  /** e^(-2πik/n) for k in [0, n), NULL for powers of two planned with radix-2 passes */
+  Complex_t *roots;
+  /** the radices 4, 2, 3 and 5 of a mixed radix transform, whose product is n */
+  size_t factors[MAX_FACTORS];
+  size_t factor_count;
+  /** size of Bluestein's convolution, a power of two >= 2n - 1 */
+  size_t m;
+  /** e^(-πik²/n) for k in [0, n) */
+  Complex_t *chirp;
+  /** transform of the conjugated chirp, divided by m, which is convolved with */
+  Complex_t *chirp_spectrum;
+  /** the six-step transform sees the input as rows of columns values, n = rows · columns */
+  size_t rows;
+  size_t columns;
+  /** e^(-2πi·c·k/n) for the transforms of each column c at index c · rows + k */
+  Complex_t *matrix_twiddles;
+  /** holds roots, chirp, chirp_spectrum and matrix_twiddles */
+  Arena_t memory;
+  /** work buffers of the transforms that are not in place, NULL for PLAN_RADIX2 */
+  struct scratchPool *scratch;
+} Plan_t;
+
+/** A transform of n real values, calculated as a complex transform of half the size */
+typedef struct realPlan {
+  size_t n;
+  /** plan for the n / 2 packed pairs of values, or for all n values if n is odd */
+  Plan_t half;
+  /** e^(-2πik/n) for k in [0, n / 4], to separate the transforms of the packed pairs */
+  Complex_t *roots;
+} RealPlan_t;
+
+/** Window functions for short-time transforms */
+typedef enum window { WINDOW_HANN, WINDOW_HAMMING, WINDOW_BLACKMAN } Window_t;
+
+bool is_power_of_two(size_t n);
+bool map_twiddles(const char *path);
+bool save_twiddles(const char *path);
+void init_plan(Plan_t *plan, size_t n);
+void init_combine_plan(Plan_t *plan, size_t n);
+void init_plan_radix(Plan_t *plan, size_t n, size_t radix);
+void execute_plan(const Plan_t *plan, Complex_t *data);
+void execute_inverse_plan(const Plan_t *plan, Complex_t *data);
+void free_plan(Plan_t *plan);
+void transform_radix2(Complex_t *data, size_t n, const Plan_t *plan);
+void combine_radix2(Complex_t *data, size_t n, const Plan_t *plan);
+void init_real_plan(RealPlan_t *plan, size_t n);
+void init_real_plan_radix(RealPlan_t *plan, size_t n, size_t radix);
+void execute_real_plan(const RealPlan_t *plan, const real_t *input, size_t stride,
+                       Complex_t *output);
+void combine_real(const RealPlan_t *plan, const Complex_t *even, const Complex_t *odd,
+                  Complex_t *output);
+void expand_spectrum(Complex_t *data, size_t n);
+void free_real_plan(RealPlan_t *plan);
+void compute_window(real_t *window, size_t n, Window_t type);
@@ -1,4 +1,11 @@
+#include "fft.h"
+#include "pool.h"
+#include "textio.h"
 #include "tools.h"
+#include "wisdom.h"
+#include <assert.h>
+#include <ctype.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -6,8 +13,10 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <math.h>
@@ -18,6 +27,7 @@
  * @brief Calculates Fast Fourier transform (FFT)
  *
  * @details Recursively creates processes to calculate fast fourier transformation.
+ * Alternatively calculates it in process, which is orders of magnitude faster.
  *
  * @author Markus Krainz
  * @date December 2018
@@ -30,16 +40,190 @@ typedef struct childData {
   pid_t pid;
 } childData_t;
 
+typedef enum engine { ENGINE_PROCESS, ENGINE_SEQUENTIAL, ENGINE_SHM, ENGINE_THREAD } Engine_t;
+
+/** Names of the engines for '-e' and in wisdom files, in the order of Engine_t */
+static const char *const *const ENGINE_NAMES = WISDOM_ENGINES;
+
+/** By default, slices of the thread engine with at most this many values are not split any
+ * further */
+#define THREAD_CUTOFF 4096
+
+/** '-t' is capped at this many threads per core, more only compete for the cores */
+#define MAX_THREADS_PER_CORE 4
+
+/** The planner runs every candidate this many times and keeps its fastest run */
+#define PLAN_RUNS 3
+
+/** The slice sizes up to which the planner lets the thread engine split */
+static const size_t PLAN_THREAD_CUTOFFS[] = {1024, 4096, 16384, 65536};
+
+/** How a transform is calculated, chosen with options or by the planner */
+typedef struct tuning {
+  Engine_t engine;
+  /** levels of processes below this one, or of task splits of the thread engine */
+  long depth;
+  /** radix of the passes of power of two plans, see init_plan_radix() */
+  size_t radix;
+} Tuning_t;
+
+/** The wisdom file given with '-W' and whether the sizes of this run are planned into it */
+typedef struct planner {
+  Wisdom_t wisdom;
+  const char *path;
+  /** the twiddle file next to the wisdom file, for the precision of this build */
+  char *twiddle_path;
+  bool measure;
+} Planner_t;
+
+/** The accuracy report compares at most this many bins with a reference DFT */
+#define ACCURACY_BINS 256
+
+/** Batch mode reads, transforms and writes this many vectors at a time, which bounds memory */
+#define BATCH_VECTORS 1024
+
+/** Batch mode keeps the plans of at most this many different lengths between batches */
+#define BATCH_PLANS 64
+
+/** The part of the transform one process of the shm engine, or one task of the thread engine
+ * is responsible for */
+typedef struct slice {
+  /** all input values, in memory shared by all processes */
+  const real_t *input;
+  /** all results, in memory shared by all processes */
+  Complex_t *output;
+  /** twiddle factors for the size of the whole transform */
+  const Plan_t *plan;
+  /** plan for the slices that are not split any further */
+  const RealPlan_t *leaf_plan;
+  /** the slice consists of input[offset + i * stride] for i in [0, n) */
+  size_t offset;
+  size_t stride;
+  size_t n;
+  /** its transform is stored in output[out .. out + n) */
+  size_t out;
+  /** levels of child processes below this one, 0 to transform the slice in process */
+  long depth;
+} Slice_t;
+
+/** How and where the results are written */
+typedef struct output {
+  /** binary for a parent process, text otherwise */
+  bool binary;
+  /** only the n / 2 + 1 results that are not redundant */
+  bool half;
+  /** a copy of the input to check the results against a reference DFT, or NULL */
+  const real_t *reference_input;
+  /** the same for complex input */
+  const Complex_t *reference_complex_input;
+  /** whether the results are an inverse transform, for the reference */
+  bool inverse;
+  /** text with the fewest digits that read back to the same values, instead of "%f" */
+  bool shortest;
+  /** nothing is written, the planner only times the transform */
+  bool discard;
+} Output_t;
+
+typedef struct sliceTask {
+  Task_t task;
+  Slice_t slice;
+} SliceTask_t;
+
+/** The vectors of batch mode that are transformed together, and what is reused between them */
+typedef struct batch {
+  /** the values of all vectors, one after the other */
+  Myvect_t values;
+  /** vector i is values[starts[i] .. starts[i + 1]), its results are at the same indexes */
+  size_t starts[BATCH_VECTORS + 1];
+  /** index of the plan of each vector in plans */
+  size_t plan_indexes[BATCH_VECTORS];
+  size_t count;
+  Complex_t *results;
+  size_t results_capacity;
+  /** the radix of the plans of each length */
+  const Wisdom_t *wisdom;
+  /** one plan per length seen so far */
+  RealPlan_t *plans;
+  size_t plan_count;
+  size_t plan_capacity;
+} Batch_t;
+
+/** Transforms the vectors [begin, end) of a batch */
+typedef struct batchTask {
+  Task_t task;
+  const Batch_t *batch;
+  size_t begin;
+  size_t end;
+  bool half;
+} BatchTask_t;
+
+static void printUsage(char *name);
+static bool readBinaryInput(Reader_t *reader, Myvect_t *myVect);
+static void writeResults(char *argv[], const Complex_t *results, size_t n,
+                         const Output_t *output);
+static void reportAccuracy(const Output_t *output, size_t n, const Complex_t *results,
+                           size_t count);
+static int processFFT(char *argv[], Myvect_t *myVect, const Output_t *output, long depth,
+                      size_t radix);
+static int sequentialFFT(char *argv[], Myvect_t *myVect, const Output_t *output, size_t radix);
+static int shmFFT(char *argv[], Myvect_t *myVect, const Output_t *output, long depth,
+                  size_t radix);
+static void transformSlice(char *argv[], const Slice_t *slice);
+static void transformSliceInProcess(const Slice_t *slice);
+static void splitSlice(const Slice_t *slice, Slice_t *even, Slice_t *odd);
+static size_t leafSize(size_t n, long depth, size_t cutoff);
+static long splitDepth(size_t n, size_t cutoff);
+static int threadFFT(char *argv[], Myvect_t *myVect, const Output_t *output, long threads,
+                     long depth, size_t radix);
+static int runEngine(char *argv[], Myvect_t *myVect, const Output_t *output,
+                     const Tuning_t *tuning, long threads);
+static Tuning_t planTransform(char *argv[], const Myvect_t *myVect, long threads, long depth);
+static void savePlan(char *argv[], Planner_t *planner, size_t n, bool inverse,
+                     const Tuning_t *tuning);
+static void freePlanner(Planner_t *planner);
+static bool engineByName(const char *name, Engine_t *engine);
+static size_t plannedRadix(const Wisdom_t *wisdom, size_t n, bool inverse);
+static size_t planInverse(const Complex_t *data, size_t n);
+static int batchFFT(char *argv[], bool half, bool accuracy, bool shortest, size_t length,
+                    long threads, const Planner_t *planner);
+static int inverseFFT(char *argv[], bool accuracy, bool shortest, Planner_t *planner);
+static int stftFFT(char *argv[], bool half, bool accuracy, bool shortest, size_t frame,
+                   size_t hop, Window_t window, const Planner_t *planner);
+static bool parseValue(const char *line, real_t *value);
+static size_t parseSize(char *argv[], char option, const char *arg, const char *what);
+
 /**
  * @brief Starts a childprocess to process FFT
  *
  * @detail Starts a new child process executing the same main. Sets up
  * stdin and stdout and returns them together with the child pid in a
  * struct childData.
+ * If a slice is given, the child is only forked and transforms the slice in shared memory
+ * instead. It has no pipes then, the parent only waits for it to exit.
  * @param argv argv of the current parent process
+ * @param slice the part of the transform in shared memory for the child, or NULL to exec
+ * @param depth levels of processes the exec'd child may still create below itself
  * @return A struct with stdin, stdout and pid of the new childprocess
  */
-static childData_t setupChild(char *argv[]) {
+static childData_t setupChild(char *argv[], const Slice_t *slice, long depth) {
+  if (slice != NULL) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      // we are a child, which must not flush the stdio buffers it copied from its parent
+      transformSlice(argv, slice);
+      _exit(EXIT_SUCCESS);
+    } else if (pid == -1) {
+      // an error has occured during forking
+      exit(EXIT_FAILURE);
+    }
+    childData_t ret = {-1, -1, pid};
+    return ret;
+  }
+
+  char depthArg[24];
+  snprintf(depthArg, sizeof(depthArg), "%ld", depth);
+
   int pipePairStdin[2];
   int pipeRet = pipe(pipePairStdin);
   if(pipeRet != 0){
@@ -72,7 +256,7 @@ static childData_t setupChild(char *argv[]) {
     close(pipePairStdin[0]);
     close(pipePairStdin[1]);
 
-    execlp(argv[0], argv[0], NULL);
+    execlp(argv[0], argv[0], "-d", depthArg, NULL);
     // execlp only returns if an error has occured
     exit(EXIT_FAILURE);
   } else if (pid == -1) {
@@ -94,33 +278,296 @@ static childData_t setupChild(char *argv[]) {
 }
 
 int main(int argc, char *argv[]) {
+  Engine_t engine = ENGINE_PROCESS;
+  int d_count = 0;
+  char *depth_arg = NULL;
+  int t_count = 0;
+  char *threads_arg = NULL;
+  bool half = false;
+  bool accuracy = false;
+  bool shortest = false;
+  bool batch = false;
+  int n_count = 0;
+  char *length_arg = NULL;
+  int e_count = 0;
+  bool inverse = false;
+  int s_count = 0;
+  char *frame_arg = NULL;
+  int p_count = 0;
+  char *hop_arg = NULL;
+  Window_t window = WINDOW_HANN;
+  int r_count = 0;
+  int m_count = 0;
+  int W_count = 0;
+  Planner_t planner;
+  init_wisdom(&planner.wisdom);
+  planner.path = NULL;
+  planner.twiddle_path = NULL;
+  planner.measure = false;
+
+  // parse arguments
+  {
+    const char *optstring = "e:d:t:raxbn:is:p:w:W:m";
+    int c;
+    int a_count = 0;
+    int x_count = 0;
+    int b_count = 0;
+    int i_count = 0;
+    int w_count = 0;
+
+    // getopt returns -1 if there is no more character
+    // Or it returns '?' in case of unknown option or missing option argument
+    while ((c = getopt(argc, argv, optstring)) != -1) {
+      switch (c) {
+      case 'e': {
+        ++e_count;
+        if (!engineByName(optarg, &engine)) {
+          fprintf(stderr, "%s ERROR unknown engine %s\n", argv[0], optarg);
+          printUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      } break;
+      case 'd': {
+        ++d_count;
+        depth_arg = optarg;
+      } break;
+      case 't': {
+        ++t_count;
+        threads_arg = optarg;
+      } break;
+      case 'r': {
+        ++r_count;
+        half = true;
+      } break;
+      case 'a': {
+        ++a_count;
+        accuracy = true;
+      } break;
+      case 'x': {
+        ++x_count;
+        shortest = true;
+      } break;
+      case 'b': {
+        ++b_count;
+        batch = true;
+      } break;
+      case 'n': {
+        ++n_count;
+        batch = true;
+        length_arg = optarg;
+      } break;
+      case 'i': {
+        ++i_count;
+        inverse = true;
+      } break;
+      case 's': {
+        ++s_count;
+        frame_arg = optarg;
+      } break;
+      case 'p': {
+        ++p_count;
+        hop_arg = optarg;
+      } break;
+      case 'w': {
+        ++w_count;
+        if (strcmp(optarg, "hann") == 0) {
+          window = WINDOW_HANN;
+        } else if (strcmp(optarg, "hamming") == 0) {
+          window = WINDOW_HAMMING;
+        } else if (strcmp(optarg, "blackman") == 0) {
+          window = WINDOW_BLACKMAN;
+        } else {
+          fprintf(stderr, "%s ERROR unknown window %s\n", argv[0], optarg);
+          printUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      } break;
+      case 'W': {
+        ++W_count;
+        planner.path = optarg;
+      } break;
+      case 'm': {
+        ++m_count;
+        planner.measure = true;
+      } break;
+      case '?': {
+        fprintf(stderr, "%s ERROR unknown option or missing argument\n", argv[0]);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+      } break;
+      default:
+        assert(0 && "We should never reach this if the optstring is valid");
+      }
+    }
+
+    if (e_count > 1 || d_count > 1 || t_count > 1 || r_count > 1 || a_count > 1 ||
+        x_count > 1 || b_count > 1 || n_count > 1 || i_count > 1 || s_count > 1 ||
+        p_count > 1 || w_count > 1 || W_count > 1 || m_count > 1) {
+      fprintf(stderr, "%s ERROR each option is only allowed once\n", argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if (optind != argc) {
+      fprintf(stderr, "%s ERROR no positional arguments expected\n", argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if ((p_count > 0 || w_count > 0) && s_count == 0) {
+      fprintf(stderr, "%s ERROR '-p' and '-w' need '-s'\n", argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if (batch + inverse + (s_count > 0) > 1) {
+      fprintf(stderr, "%s ERROR batch, inverse and STFT mode cannot be combined\n", argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if ((batch || inverse || s_count > 0) && (e_count > 0 || d_count > 0)) {
+      fprintf(stderr,
+              "%s ERROR batch, inverse and STFT mode always calculate in process, without '-e' "
+              "or '-d'\n",
+              argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if (m_count > 0 && (W_count == 0 || e_count > 0 || d_count > 0 || batch || s_count > 0)) {
+      fprintf(stderr, "%s ERROR '-m' needs '-W' and chooses the engine and depth itself, it "
+                      "plans one transform, not batch or STFT mode\n",
+              argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if (inverse && r_count > 0) {
+      fprintf(stderr, "%s ERROR the input of the inverse transform is not real, so '-r' does "
+                      "not apply\n",
+              argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
 
-  fprintf(stderr, "Running main()... My pid is: %d\n", (int)getpid());
+  const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  // by default there are about as many processes at the bottom of the tree as cores
+  long depth = 0;
+  if (d_count > 0) {
+    char *endPointer;
+    errno = 0;
+    depth = strtol(depth_arg, &endPointer, 10);
+    if (errno != 0 || *endPointer != '\0' || depth < 0) {
+      fprintf(stderr, "%s ERROR '-d' expects a number of levels\n", argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    while (cores > 1L << depth) {
+      ++depth;
+    }
+  }
+
+  long threads = cores;
+  if (t_count > 0) {
+    char *endPointer;
+    errno = 0;
+    threads = strtol(threads_arg, &endPointer, 10);
+    if (errno != 0 || *endPointer != '\0' || threads < 1) {
+      fprintf(stderr, "%s ERROR '-t' expects a number of threads\n", argv[0]);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    if (threads > MAX_THREADS_PER_CORE * cores) {
+      fprintf(stderr, "%s WARNING %ld threads on %ld cores, using %ld\n", argv[0], threads, cores,
+              MAX_THREADS_PER_CORE * cores);
+      threads = MAX_THREADS_PER_CORE * cores;
+    }
+  }
+
+  size_t wisdomLine;
+  if (W_count > 0 && !load_wisdom(&planner.wisdom, planner.path, &wisdomLine)) {
+    if (wisdomLine > 0) {
+      fprintf(stderr, "%s ERROR invalid line %zu in wisdom file %s\n", argv[0], wisdomLine,
+              planner.path);
+    } else {
+      fprintf(stderr, "%s ERROR cannot read wisdom file %s\n", argv[0], planner.path);
+    }
+    exit(EXIT_FAILURE);
+  }
+  if (W_count > 0) {
+    const size_t length = strlen(planner.path) + strlen(WISDOM_PRECISION) + sizeof("..twiddles");
+    planner.twiddle_path = malloc(length);
+    if (unlikely(planner.twiddle_path == NULL)) {
+      // out of memory
+      exit(EXIT_FAILURE);
+    }
+    snprintf(planner.twiddle_path, length, "%s.%s.twiddles", planner.path, WISDOM_PRECISION);
+    // without the file, or with one of another build, the tables are computed as usual
+    map_twiddles(planner.twiddle_path);
+  }
+
+  if (batch) {
+    const size_t length =
+        n_count > 0 ? parseSize(argv, 'n', length_arg, "the number of values per vector") : 0;
+    const int result = batchFFT(argv, half, accuracy, shortest, length, threads, &planner);
+    freePlanner(&planner);
+    return result;
+  }
+  if (inverse) {
+    const int result = inverseFFT(argv, accuracy, shortest, &planner);
+    freePlanner(&planner);
+    return result;
+  }
+  if (s_count > 0) {
+    const size_t frame = parseSize(argv, 's', frame_arg, "the number of values per frame");
+    const size_t hop = p_count > 0 ? parseSize(argv, 'p', hop_arg, "the number of values "
+                                                                   "between frames")
+                                   : (frame + 1) / 2;
+    const int result = stftFFT(argv, half, accuracy, shortest, frame, hop, window, &planner);
+    freePlanner(&planner);
+    return result;
+  }
+
+  // only the process engine reports what each of its many processes is doing
+  const bool verbose = engine == ENGINE_PROCESS;
+
+  if (verbose) {
+    fprintf(stderr, "Running main()... My pid is: %d\n", (int)getpid());
+  }
 
   Myvect_t myVect;
   init_myvect(&myVect);
 
-  // read input
-  {
-    size_t linebufferSize = 0;
-    char *line = NULL;
-    while ((getline(&line, &linebufferSize, stdin)) != -1) {
-      char *endPointer;
-      const float valueOfThisLine = strtof(line, &endPointer);
-      if(endPointer == NULL || (*endPointer != '\r' && *endPointer != '\n' && *endPointer != '\0')){
+  // read input, which is binary if we are a child and text otherwise
+  Reader_t reader;
+  init_reader(&reader, STDIN_FILENO);
+  const bool binary = peek_byte(&reader) == BINARY_MAGIC[0];
+  if (binary) {
+    if (!readBinaryInput(&reader, &myVect)) {
+      fprintf(stderr, "%s Could not read binary input. My pid is: %d\n", argv[0], (int)getpid());
+      free_reader(&reader);
+      freedata_myvect(&myVect);
+      return EXIT_FAILURE;
+    }
+  } else {
+    // one value per line, so most inputs are read without moving the values
+    reserve_myvect(&myVect, estimate_lines(&reader));
+    char *line;
+    while ((line = read_line(&reader)) != NULL) {
+      real_t valueOfThisLine;
+      if (!parseValue(line, &valueOfThisLine)) {
         fprintf(stderr, "%s Could not parse input value: %s. My pid is: %d\n", argv[0], line, (int)getpid());
-        free(line);
+        free_reader(&reader);
         freedata_myvect(&myVect);
         return EXIT_FAILURE;
-      } else{
-         fprintf(stderr, "Parsed");
       }
       push_myvect(&myVect, valueOfThisLine);
     }
-    free(line);
   }
+  free_reader(&reader);
+  // parents only need the bins that are not redundant
+  half = half || binary;
 
-  fprintf(stderr, "Read %zu floats from stdin. My pid is: %d\n", myVect.size, (int)getpid());
+  if (verbose) {
+    fprintf(stderr, "Read %zu values from stdin. My pid is: %d\n", myVect.size, (int)getpid());
+  }
 
   if (myVect.size == 0) {
     freedata_myvect(&myVect);
@@ -128,84 +575,381 @@ int main(int argc, char *argv[]) {
   }
 
   if (myVect.size == 1) {
-    fprintf(stdout, "%f 0.0*i", myVect.data[0]);
-    fprintf(stderr, "Wrote result! My pid is: %d\n", (int)getpid());
+    const Complex_t result = {myVect.data[0], 0};
+    if (binary) {
+      const Output_t output = {true, true, NULL, NULL, false, false, false};
+      writeResults(argv, &result, 1, &output);
+    } else {
+      write_complex(stdout, &result, 1, shortest);
+    }
+    if (verbose) {
+      fprintf(stderr, "Wrote result! My pid is: %d\n", (int)getpid());
+    }
     freedata_myvect(&myVect);
     return EXIT_SUCCESS;
   }
 
-  if (myVect.size % 2 != 0) {
-    freedata_myvect(&myVect);
-    return EXIT_FAILURE;
+  // explicit options come first, then the wisdom file, then the defaults
+  Tuning_t tuning = {engine, depth, 2};
+  if (engine == ENGINE_THREAD && d_count == 0) {
+    tuning.depth = splitDepth(myVect.size, THREAD_CUTOFF);
   }
+  if (planner.measure) {
+    tuning = planTransform(argv, &myVect, threads, depth);
+    savePlan(argv, &planner, myVect.size, false, &tuning);
+  } else if (e_count == 0 && d_count == 0) {
+    const WisdomEntry_t *entry = find_wisdom(&planner.wisdom, myVect.size, false);
+    if (entry != NULL && engineByName(entry->engine, &tuning.engine)) {
+      tuning.depth = entry->depth;
+      tuning.radix = entry->radix;
+    }
+  }
+  freePlanner(&planner);
 
-  childData_t even = setupChild(argv);
-  childData_t odd = setupChild(argv);
+  Output_t output = {binary, half, NULL, NULL, false, shortest, false};
+  real_t *referenceInput = NULL;
+  if (accuracy && !binary) {
+    // the engines free the input before they write the results
+    referenceInput = alloc_aligned(sizeof(real_t) * myVect.size);
+    memcpy(referenceInput, myVect.data, sizeof(real_t) * myVect.size);
+    output.reference_input = referenceInput;
+  }
 
-  fprintf(stderr, "Send data to children...\n");
-  // send data to children
-  {
-    FILE *childEvenFp = fdopen(even.stdin, "w");
-    FILE *childOddFp = fdopen(odd.stdin, "w");
+  const int result = runEngine(argv, &myVect, &output, &tuning, threads);
+  free(referenceInput);
+  return result;
+}
+
+/**
+ * @brief Prints help including arguments of this program to stderr.
+ *
+ * @param name c_string of the name of the executable
+ */
+static void printUsage(char *name) {
+  fprintf(stderr, "\nUsage:\n\n");
+  fprintf(stderr, "%s [-e process|sequential|shm|thread] [-d depth] [-t threads] [-r] [-a] [-x]\n"
+                  "\t[-W wisdom] < input\n",
+          name);
+  fprintf(stderr, "%s -W wisdom -m [-t threads] [-r] [-a] [-x] < input\n", name);
+  fprintf(stderr, "%s -b|-n length [-t threads] [-r] [-a] [-x] [-W wisdom] < input\n", name);
+  fprintf(stderr, "%s -i [-a] [-x] [-W wisdom [-m]] < input\n", name);
+  fprintf(stderr, "%s -s frame [-p hop] [-w hann|hamming|blackman] [-r] [-a] [-x] [-W wisdom]"
+                  " < input\n",
+          name);
+  fprintf(stderr, "\treads one number per line, any number of them, calculating in %s\n",
+          REAL_NAME);
+  fprintf(stderr, "\t-e process forks two children per level of the recursion (default),\n"
+                  "\t   sequential computes the whole transform in this process,\n"
+                  "\t   shm forks without exec and the children work in shared memory,\n"
+                  "\t   thread splits the work between threads that steal it from each other\n");
+  fprintf(stderr, "\t-d levels of processes below this one, the processes at the bottom\n"
+                  "\t   calculate their part in process. Default is enough for all cores.\n"
+                  "\t   For the thread engine the levels of splits, default down to %d values\n",
+          THREAD_CUTOFF);
+  fprintf(stderr, "\t-t number of threads of the thread engine or batch mode, default one per\n"
+                  "\t   core, at most %d per core\n",
+          MAX_THREADS_PER_CORE);
+  fprintf(stderr, "\t-r only prints the first n / 2 + 1 results, the others are their complex\n"
+                  "\t   conjugates in reverse order, as the input is real\n");
+  fprintf(stderr, "\t-a reports the error of the results against a discrete Fourier transform\n"
+                  "\t   calculated directly in long double\n");
+  fprintf(stderr, "\t-x prints the fewest digits that read back to the same values instead of\n"
+                  "\t   six decimals\n");
+  fprintf(stderr, "\t-b batch mode: transforms many vectors, separated by blank lines, in process\n"
+                  "\t   and writes their results in the same order, separated by blank lines\n");
+  fprintf(stderr, "\t-n batch mode with vectors of length values each, blank lines are ignored\n");
+  fprintf(stderr, "\t-i inverse transform of complex values, one per line as 're im*i' or 're'\n");
+  fprintf(stderr, "\t-s short-time transform of a stream of values in frames of this size,\n"
+                  "\t   whose results are written as soon as the frame is complete\n");
+  fprintf(stderr, "\t-p values from the start of one frame to the next, default half a frame\n");
+  fprintf(stderr, "\t-w window function of the frames, default hann\n");
+  fprintf(stderr, "\t-W wisdom file with the engine, depth and radix planned for each size,\n"
+                  "\t   which are used unless '-e' or '-d' are given, and the twiddle factors\n"
+                  "\t   in wisdom.precision.twiddles next to it\n");
+  fprintf(stderr, "\t-m plans the size of the input: times the engines, depths and radices,\n"
+                  "\t   stores the fastest in the wisdom file and transforms with it\n");
+}
+
+/**
+ * @brief Parses a line with one value
+ *
+ * @param line the line, with or without line break
+ * @param value is set to the value
+ * @return true on success, false if the line is not a single number
+ */
+static bool parseValue(const char *line, real_t *value) {
+  char *endPointer;
+  *value = parse_real(line, &endPointer);
+  return *endPointer == '\r' || *endPointer == '\n' || *endPointer == '\0';
+}
+
+/**
+ * @brief Parses a positive number of the argument of an option or terminates the application
+ *
+ * @param argv argv of the current process
+ * @param option the option
+ * @param arg its argument
+ * @param what what the number is, for the error message
+ */
+static size_t parseSize(char *argv[], char option, const char *arg, const char *what) {
+  char *endPointer;
+  errno = 0;
+  const long size = strtol(arg, &endPointer, 10);
+  if (errno != 0 || *endPointer != '\0' || size < 1) {
+    fprintf(stderr, "%s ERROR '-%c' expects %s\n", argv[0], option, what);
+    printUsage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  return size;
+}
+
+/**
+ * @brief Parses a line with one complex value, as written by forkFFT, or a real one
+ *
+ * @detail Accepts "re", "re im" and "re im*i".
+ * @param line the line, with or without line break
+ * @param value is set to the value
+ * @return true on success, false if the line is not a single number
+ */
+static bool parseComplex(const char *line, Complex_t *value) {
+  char *endPointer;
+  value->re = parse_real(line, &endPointer);
+  value->im = 0;
+  if (endPointer == line) {
+    return false;
+  }
 
-    for (size_t i = 0; i < myVect.size; i += 2) {
-      fprintf(childEvenFp, "%f\n", myVect.data[i]);
+  while (*endPointer == ' ' || *endPointer == '\t') {
+    ++endPointer;
+  }
+  if (*endPointer != '\r' && *endPointer != '\n' && *endPointer != '\0') {
+    const char *imaginary = endPointer;
+    value->im = parse_real(imaginary, &endPointer);
+    if (endPointer == imaginary) {
+      return false;
     }
-    for (size_t i = 1; i < myVect.size; i += 2) {
-      fprintf(childOddFp, "%f\n", myVect.data[i]);
+    if (strncmp(endPointer, "*i", 2) == 0) {
+      endPointer += 2;
     }
+  }
+  return *endPointer == '\r' || *endPointer == '\n' || *endPointer == '\0';
+}
 
-    fclose(childEvenFp);
-    fclose(childOddFp);
-    close(even.stdin);
-    close(odd.stdin);
+/**
+ * @brief Reads binary input
+ *
+ * @param reader the reader of stdin
+ * @param myVect the vector the elements are appended to
+ * @return true on success, false if the header does not match or the input ends early
+ */
+static bool readBinaryInput(Reader_t *reader, Myvect_t *myVect) {
+  BinaryHeader_t header;
+  if (!read_bytes(reader, &header, sizeof(header)) ||
+      memcmp(header.magic, BINARY_MAGIC, BINARY_MAGIC_LENGTH) != 0 ||
+      header.element_size != sizeof(real_t)) {
+    return false;
   }
 
-  const size_t resultSize = myVect.size;
-  freedata_myvect(&myVect);
+  // the header says how many elements follow, so they are read in place
+  reserve_myvect(myVect, myVect->size + header.count);
+  if (!read_bytes(reader, myVect->data + myVect->size, sizeof(real_t) * header.count)) {
+    return false;
+  }
+  myVect->size += header.count;
+  return true;
+}
 
-  fprintf(stderr, "Read data from children...\n");
-  // read data from children
-  // C99 Variable Length Arrays
-  float resultEven[resultSize / 2];
-  float resultOdd[resultSize / 2];
-  float resultEvenImaginary[resultSize / 2];
-  float resultOddImaginary[resultSize / 2];
-  {
-    FILE *childEvenFp = fdopen(even.stdout, "r");
-    FILE *childOddFp = fdopen(odd.stdout, "r");
-    size_t linebufferSize = 0;
-    char *line = NULL;
-
-    for (size_t k = 0; k < resultSize / 2; ++k) {
-      char *endPointer;
-
-      int res = getline(&line, &linebufferSize, childEvenFp);
-      if (res == -1) {
-        fprintf(stderr, "%s Cannot read even! My pid is: %d\n", argv[0], (int)getpid());
-        free(line);
-        exit(EXIT_FAILURE);
-      }
-      resultEven[k] = strtof(line, &endPointer);
-      resultEvenImaginary[k] = strtof(endPointer, &endPointer);
+/**
+ * @brief Writes the transform to stdout, as text or binary for a parent process
+ *
+ * @detail Terminates the application if writing fails.
+ * @param argv argv of the current process
+ * @param results the transform
+ * @param n size of the transform
+ * @param output how to write them, and whether to report their accuracy afterwards
+ */
+static void writeResults(char *argv[], const Complex_t *results, size_t n,
+                         const Output_t *output) {
+  const size_t count = output->half ? n / 2 + 1 : n;
+  if (output->discard) {
+    return;
+  }
+  if (!output->binary) {
+    write_complex(stdout, results, count, output->shortest);
+    if (output->reference_input != NULL || output->reference_complex_input != NULL) {
+      reportAccuracy(output, n, results, count);
+    }
+    return;
+  }
 
-      res = getline(&line, &linebufferSize, childOddFp);
-      if (res == -1) {
-        fprintf(stderr, "%s Cannot read odd! My pid is: %d\n", argv[0], (int)getpid());
-        free(line);
-        exit(EXIT_FAILURE);
+  BinaryHeader_t header = {BINARY_MAGIC, sizeof(Complex_t), count};
+  struct iovec iov[] = {{&header, sizeof(header)},
+                        {(void *)results, sizeof(Complex_t) * count}};
+  fflush(stdout);
+  if (write_all(STDOUT_FILENO, iov, 2) == -1) {
+    fprintf(stderr, "%s Cannot write results! My pid is: %d\n", argv[0], (int)getpid());
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Compares results with a discrete Fourier transform calculated directly in long double
+ *
+ * @detail Each bin of the reference takes O(n), so at most ACCURACY_BINS evenly spaced bins are
+ * compared. Prints the largest absolute error, and the same relative to the largest bin, to
+ * stderr. Terminates the application if memory allocation fails.
+ * @param output the copy of the input and the direction of the transform
+ * @param n size of the transform
+ * @param results the first count bins of the transform
+ * @param count number of bins that were written
+ */
+static void reportAccuracy(const Output_t *output, size_t n, const Complex_t *results,
+                           size_t count) {
+  // e^(∓2πik/n) for k in [0, n)
+  const long double sign = output->inverse ? 1 : -1;
+  long double *roots = malloc(sizeof(long double) * 2 * n);
+  if (unlikely(roots == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  for (size_t k = 0; k < n; ++k) {
+    roots[2 * k] = cosl(sign * 2 * PI * k / n);
+    roots[2 * k + 1] = sinl(sign * 2 * PI * k / n);
+  }
+
+  const size_t step = count > ACCURACY_BINS ? count / ACCURACY_BINS : 1;
+  long double maxError = 0, maxMagnitude = 0;
+  size_t compared = 0;
+  for (size_t k = 0; k < count; k += step) {
+    long double re = 0, im = 0;
+    size_t index = 0;
+    for (size_t j = 0; j < n; ++j) {
+      const long double xRe = output->reference_input != NULL
+                                  ? output->reference_input[j]
+                                  : output->reference_complex_input[j].re;
+      const long double xIm =
+          output->reference_input != NULL ? 0 : output->reference_complex_input[j].im;
+      re += xRe * roots[2 * index] - xIm * roots[2 * index + 1];
+      im += xRe * roots[2 * index + 1] + xIm * roots[2 * index];
+      // index is k * j modulo n
+      index += k;
+      if (index >= n) {
+        index -= n;
       }
-      resultOdd[k] = strtof(line, &endPointer);
-      resultOddImaginary[k] = strtof(endPointer, &endPointer);
     }
+    if (output->inverse) {
+      re /= n;
+      im /= n;
+    }
+    const long double error = hypotl(results[k].re - re, results[k].im - im);
+    maxError = error > maxError ? error : maxError;
+    const long double magnitude = hypotl(re, im);
+    maxMagnitude = magnitude > maxMagnitude ? magnitude : maxMagnitude;
+    ++compared;
+  }
+  free(roots);
+
+  fprintf(stderr,
+          "Accuracy of %s against a long double DFT in %zu of %zu bins: max absolute error "
+          "%Le, relative to the largest bin %Le\n",
+          REAL_NAME, compared, count, maxError, maxMagnitude > 0 ? maxError / maxMagnitude : 0);
+}
+
+/**
+ * @brief Sends every second element to a child in binary and closes its stdin
+ *
+ * @detail Terminates the application if writing fails.
+ * @param argv argv of the current process
+ * @param fd stdin of the child
+ * @param myVect the input
+ * @param first 0 for the even elements, 1 for the odd ones
+ * @param data room for myVect->size / 2 elements, which are gathered there to be sent
+ */
+static void sendToChild(char *argv[], int fd, const Myvect_t *myVect, size_t first,
+                        real_t *data) {
+  const size_t n = myVect->size / 2;
+  for (size_t i = 0; i < n; ++i) {
+    data[i] = myVect->data[2 * i + first];
+  }
 
-    free(line);
+  BinaryHeader_t header = {BINARY_MAGIC, sizeof(real_t), n};
+  struct iovec iov[] = {{&header, sizeof(header)}, {data, sizeof(real_t) * n}};
+  if (write_all(fd, iov, 2) == -1) {
+    fprintf(stderr, "%s Cannot send data to child! My pid is: %d\n", argv[0], (int)getpid());
+    exit(EXIT_FAILURE);
+  }
+  close(fd);
+}
 
-    fclose(childEvenFp);
-    fclose(childOddFp);
-    close(even.stdout);
-    close(odd.stdout);
+/**
+ * @brief Reads the binary transform of a child and closes its stdout
+ *
+ * @detail Terminates the application if the child does not deliver n results.
+ * @param argv argv of the current process
+ * @param fd stdout of the child
+ * @param results where the n results are stored
+ * @param n number of results expected
+ */
+static void readFromChild(char *argv[], int fd, Complex_t *results, size_t n) {
+  BinaryHeader_t header;
+  if (read_all(fd, &header, sizeof(header)) == -1 ||
+      memcmp(header.magic, BINARY_MAGIC, BINARY_MAGIC_LENGTH) != 0 ||
+      header.element_size != sizeof(Complex_t) || header.count != n ||
+      read_all(fd, results, sizeof(Complex_t) * n) == -1) {
+    fprintf(stderr, "%s Cannot read results of child! My pid is: %d\n", argv[0], (int)getpid());
+    exit(EXIT_FAILURE);
   }
+  close(fd);
+}
+
+/**
+ * @brief Calculates the FFT with two child processes, which do the same recursively
+ *
+ * @detail Sends the even and odd elements to the children, and combines their results. The
+ * children are always talked to in binary, so no precision is lost in between, and only send
+ * the bins of their transform that are not redundant.
+ * Below the given depth, or if the size is odd, the transform is calculated in process instead.
+ * @param argv argv of the current process, to start the children with
+ * @param myVect the input, whose size is at least 2. It is freed.
+ * @param output how to write the results
+ * @param depth levels of processes that may still be created, 0 to not create any
+ * @param radix the radix of the plan if this process transforms in process, the children use 2
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int processFFT(char *argv[], Myvect_t *myVect, const Output_t *output, long depth,
+                      size_t radix) {
+  if (depth == 0 || myVect->size % 2 != 0) {
+    // the processes above are enough to keep all cores busy, or the input cannot be halved
+    return sequentialFFT(argv, myVect, output, radix);
+  }
+
+  const size_t resultSize = myVect->size;
+  // the bins of the even elements followed by the odd ones, and room for all results
+  const size_t childBins = resultSize / 4 + 1;
+  // everything this process needs besides the input
+  Arena_t arena;
+  init_arena(&arena, ARENA_BLOCK_SIZE(sizeof(real_t) * resultSize / 2) * 2 +
+                         ARENA_BLOCK_SIZE(sizeof(Complex_t) * (2 * childBins + resultSize)));
+
+  childData_t even = setupChild(argv, NULL, depth - 1);
+  childData_t odd = setupChild(argv, NULL, depth - 1);
+
+  fprintf(stderr, "Send data to children...\n");
+  sendToChild(argv, even.stdin, myVect, 0,
+              alloc_arena(&arena, sizeof(real_t) * resultSize / 2));
+  sendToChild(argv, odd.stdin, myVect, 1, alloc_arena(&arena, sizeof(real_t) * resultSize / 2));
+  freedata_myvect(myVect);
+
+  fprintf(stderr, "Read data from children...\n");
+  Complex_t *childResults =
+      alloc_arena(&arena, sizeof(Complex_t) * (2 * childBins + resultSize));
+  Complex_t *results = childResults + 2 * childBins;
+  readFromChild(argv, even.stdout, childResults, childBins);
+  readFromChild(argv, odd.stdout, childResults + childBins, childBins);
+  fprintf(stderr, "Moved %zu bytes through pipes to and from children. My pid is: %d\n",
+          2 * (2 * sizeof(BinaryHeader_t) + sizeof(real_t) * (resultSize / 2) +
+               sizeof(Complex_t) * childBins),
+          (int)getpid());
 
   fprintf(stderr, "Wait for children to die...\n");
   // wait for children to die
@@ -226,6 +970,7 @@ int main(int argc, char *argv[]) {
     }
 
     if (WEXITSTATUS(status) != EXIT_SUCCESS) {
+      free_arena(&arena);
       return EXIT_FAILURE;
     }
 
@@ -241,40 +986,852 @@ int main(int argc, char *argv[]) {
   }
 
   fprintf(stderr, "Calculating and outputting own results...\n");
-  const float minus2PIDividedbyResultSize = -2 * PI / resultSize;
-  for (int i = 0; i < resultSize; ++i) {
-    const int k = i % (resultSize / 2);
+  RealPlan_t plan;
+  init_real_plan(&plan, resultSize);
+  combine_real(&plan, childResults, childResults + childBins, results);
+  free_real_plan(&plan);
+  if (!output->half) {
+    expand_spectrum(results, resultSize);
+  }
+
+  writeResults(argv, results, resultSize, output);
+  free_arena(&arena);
+  return EXIT_SUCCESS;
+}
 
-    float rightSide;
-    float rightSideImaginary;
-    {
-      // cos(- 2π/n · k) + i · sin(-2π/ n · k)
+/**
+ * @brief Calculates the FFT in process
+ *
+ * @detail Prints the results in the same format as the process engine. The input is real, so
+ * it is transformed as a complex transform of half the size.
+ * @param argv argv of the current process
+ * @param myVect the input, whose size is at least 2. It is freed.
+ * @param output how to write the results
+ * @param radix the radix of the plan, see init_plan_radix()
+ * @return EXIT_SUCCESS
+ */
+static int sequentialFFT(char *argv[], Myvect_t *myVect, const Output_t *output, size_t radix) {
+  const size_t n = myVect->size;
+  Complex_t *data = alloc_aligned(sizeof(Complex_t) * n);
 
-      const float factor = cos(minus2PIDividedbyResultSize * k);
-      const float factorImaginary = sin(minus2PIDividedbyResultSize * k);
+  RealPlan_t plan;
+  init_real_plan_radix(&plan, n, radix);
+  execute_real_plan(&plan, myVect->data, 1, data);
+  free_real_plan(&plan);
+  freedata_myvect(myVect);
+  if (!output->half) {
+    expand_spectrum(data, n);
+  }
 
-      const float odd = resultOdd[i % (resultSize / 2)];
-      const float oddImaginary = resultOddImaginary[i % (resultSize / 2)];
+  writeResults(argv, data, n, output);
+  free(data);
+  return EXIT_SUCCESS;
+}
 
-      //(a[r]+a[i])(c[r]+c[i]) = a[r]·c[r] - a[i]·c[i] + i·(a[r]·c[i]+a[i]·c[r]);
-      rightSide = factor * odd - factorImaginary * oddImaginary;
-      rightSideImaginary = factor * oddImaginary + factorImaginary * odd;
+/**
+ * @brief Transforms the real values of a slice into its output
+ *
+ * @detail Only the bins that are not redundant are calculated, the others are mirrored.
+ * @param slice the slice
+ */
+static void transformSliceInProcess(const Slice_t *slice) {
+  Complex_t *const out = slice->output + slice->out;
+  execute_real_plan(slice->leaf_plan, slice->input + slice->offset, slice->stride, out);
+  expand_spectrum(out, slice->n);
+}
+
+/**
+ * @brief Splits a slice into its even and odd elements
+ *
+ * @detail Their transforms are stored next to each other in the output range of the slice, so
+ * combine_radix2() can combine them in place.
+ * @param slice the slice, with n >= 2
+ * @param even is set to the slice of the even elements
+ * @param odd is set to the slice of the odd elements
+ */
+static void splitSlice(const Slice_t *slice, Slice_t *even, Slice_t *odd) {
+  *even = *slice;
+  even->stride = 2 * slice->stride;
+  even->n = slice->n / 2;
+  even->depth = slice->depth - 1;
+  *odd = *even;
+  odd->offset = slice->offset + slice->stride;
+  odd->out = slice->out + slice->n / 2;
+}
+
+/**
+ * @brief Returns the size of the slices that are not split any further
+ *
+ * @detail Slices are halved up to depth times while they are even and bigger than cutoff, and
+ * all of them are split the same way, so they end up the same size.
+ * @param n size of the whole transform
+ * @param depth maximum number of splits
+ * @param cutoff slices up to this size are not split
+ */
+static size_t leafSize(size_t n, long depth, size_t cutoff) {
+  while (depth > 0 && n > cutoff && n % 2 == 0) {
+    n /= 2;
+    --depth;
+  }
+  return n;
+}
+
+/**
+ * @brief Returns how often slices are halved until they have at most cutoff values
+ *
+ * @param n size of the whole transform
+ * @param cutoff slices up to this size are not split
+ */
+static long splitDepth(size_t n, size_t cutoff) {
+  long depth = 0;
+  while (n > cutoff && n % 2 == 0) {
+    n /= 2;
+    ++depth;
+  }
+  return depth;
+}
+
+/**
+ * @brief Waits for a child of the shm engine and terminates the application if it failed
+ *
+ * @param argv argv of the current process
+ * @param pid the child
+ */
+static void waitForChild(char *argv[], pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) == -1) {
+    if (errno != EINTR) {
+      fprintf(stderr, "%s Cannot wait!\n", argv[0]);
+      exit(EXIT_FAILURE);
     }
+  }
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    // the child already said what went wrong
+    exit(EXIT_FAILURE);
+  }
+}
 
-    float result = resultEven[i % (resultSize / 2)];
-    float resultImaginary = resultEvenImaginary[i % (resultSize / 2)];
-    if (i < resultSize / 2) {
-      result += rightSide;
-      resultImaginary += rightSideImaginary;
-    } else {
-      result -= rightSide;
-      resultImaginary -= rightSideImaginary;
+/**
+ * @brief Transforms a slice of the input with two child processes, which do the same recursively
+ *
+ * @detail The children store the transforms of the even and odd elements of the slice next to
+ * each other in the output, where they are combined in place. So no data is copied between
+ * processes at all.
+ * @param argv argv of the current process
+ * @param slice the part of the transform this process is responsible for
+ */
+static void transformSlice(char *argv[], const Slice_t *slice) {
+  if (slice->n % 2 != 0 || slice->depth == 0) {
+    transformSliceInProcess(slice);
+    return;
+  }
+
+  Slice_t evenSlice, oddSlice;
+  splitSlice(slice, &evenSlice, &oddSlice);
+
+  childData_t even = setupChild(argv, &evenSlice, 0);
+  childData_t odd = setupChild(argv, &oddSlice, 0);
+  waitForChild(argv, even.pid);
+  waitForChild(argv, odd.pid);
+
+  combine_radix2(slice->output + slice->out, slice->n, slice->plan);
+}
+
+/**
+ * @brief Calculates the FFT with a tree of forked processes sharing one memory mapping
+ *
+ * @detail The input and output live in one anonymous shared mapping, which the children inherit
+ * when they are forked without exec. Each child works in place on its strided slice and only
+ * signals completion by exiting, so there are no pipes involved. Below the given depth, slices are
+ * transformed in process, as are slices of odd size.
+ * @param argv argv of the current process
+ * @param myVect the input, whose size is at least 2. It is freed.
+ * @param output how to write the results
+ * @param depth levels of processes that may be created, 0 to not create any
+ * @param radix the radix of the plan of the slices that are transformed in process
+ * @return EXIT_SUCCESS
+ */
+static int shmFFT(char *argv[], Myvect_t *myVect, const Output_t *output, long depth,
+                  size_t radix) {
+  const size_t n = myVect->size;
+
+  const size_t mappingSize = sizeof(Complex_t) * n + sizeof(real_t) * n;
+  void *mapping =
+      mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    fprintf(stderr, "%s Cannot map shared memory: %s\n", argv[0], strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  Complex_t *results = mapping;
+  real_t *input = (real_t *)(results + n);
+  memcpy(input, myVect->data, sizeof(real_t) * n);
+  freedata_myvect(myVect);
+
+  Plan_t plan;
+  RealPlan_t leafPlan;
+  init_combine_plan(&plan, n);
+  init_real_plan_radix(&leafPlan, leafSize(n, depth, 1), radix);
+  const Slice_t slice = {input, results, &plan, &leafPlan, 0, 1, n, 0, depth};
+  transformSlice(argv, &slice);
+  free_real_plan(&leafPlan);
+  free_plan(&plan);
+
+  writeResults(argv, results, n, output);
+  munmap(mapping, mappingSize);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Transforms the slice of a task, spawning tasks for its even and odd elements
+ *
+ * @detail Slices at the depth of the engine are transformed inline, which is faster than
+ * splitting them further and fits the caches, as are slices of odd size. One half is spawned,
+ * so an idle worker can steal it, and the other one is transformed right away.
+ * @param worker the worker running the task
+ * @param task a SliceTask_t
+ */
+static void transformSliceTask(Worker_t *worker, Task_t *task) {
+  const Slice_t *slice = &((SliceTask_t *)task)->slice;
+  if (slice->depth == 0 || slice->n % 2 != 0) {
+    transformSliceInProcess(slice);
+    return;
+  }
+
+  SliceTask_t even, odd;
+  even.task.run = transformSliceTask;
+  odd.task.run = transformSliceTask;
+  splitSlice(slice, &even.slice, &odd.slice);
+
+  spawn_task(worker, &odd.task);
+  run_task(worker, &even.task);
+  join_task(worker, &odd.task);
+
+  combine_radix2(slice->output + slice->out, slice->n, slice->plan);
+}
+
+/**
+ * @brief Calculates the FFT with a pool of threads that steal the halves of slices
+ *
+ * @detail Same recursion as the shm engine, but the halves are tasks instead of processes, so
+ * there is no process creation and no communication besides the memory all threads share.
+ * @param argv argv of the current process
+ * @param myVect the input, whose size is at least 2. It is freed.
+ * @param output how to write the results
+ * @param threads number of threads, including the calling one
+ * @param depth levels of splits, each halves the slices
+ * @param radix the radix of the plan of the slices that are not split
+ * @return EXIT_SUCCESS
+ */
+static int threadFFT(char *argv[], Myvect_t *myVect, const Output_t *output, long threads,
+                     long depth, size_t radix) {
+  const size_t n = myVect->size;
+
+  Complex_t *results = alloc_aligned(sizeof(Complex_t) * n);
+
+  Plan_t plan;
+  RealPlan_t leafPlan;
+  init_combine_plan(&plan, n);
+  init_real_plan_radix(&leafPlan, leafSize(n, depth, 1), radix);
+  SliceTask_t root = {{transformSliceTask, 0},
+                      {myVect->data, results, &plan, &leafPlan, 0, 1, n, 0, depth}};
+
+  Pool_t pool;
+  start_pool(&pool, threads);
+  run_task(main_worker(&pool), &root.task);
+  stop_pool(&pool);
+
+  free_real_plan(&leafPlan);
+  free_plan(&plan);
+  freedata_myvect(myVect);
+  writeResults(argv, results, n, output);
+  free(results);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Calculates the FFT with the engine, depth and radix of a tuning
+ *
+ * @param argv argv of the current process
+ * @param myVect the input, whose size is at least 2. It is freed.
+ * @param output how to write the results
+ * @param tuning how to calculate the transform
+ * @param threads number of threads of the thread engine
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int runEngine(char *argv[], Myvect_t *myVect, const Output_t *output,
+                     const Tuning_t *tuning, long threads) {
+  switch (tuning->engine) {
+  case ENGINE_PROCESS:
+    return processFFT(argv, myVect, output, tuning->depth, tuning->radix);
+  case ENGINE_SEQUENTIAL:
+    return sequentialFFT(argv, myVect, output, tuning->radix);
+  case ENGINE_SHM:
+    return shmFFT(argv, myVect, output, tuning->depth, tuning->radix);
+  case ENGINE_THREAD:
+    return threadFFT(argv, myVect, output, threads, tuning->depth, tuning->radix);
+  }
+  assert(0 && "We should never reach this with a valid engine");
+  return EXIT_FAILURE;
+}
+
+/**
+ * @brief Returns the time of a monotonic clock in seconds
+ */
+static double now(void) {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Times a candidate of the planner and keeps it if it is the fastest so far
+ *
+ * @detail The candidate transforms a copy of the input PLAN_RUNS times without writing the
+ * results, and its fastest run counts. Its time is printed to stderr.
+ * @param argv argv of the current process
+ * @param myVect the input, which is not changed
+ * @param threads number of threads of the thread engine
+ * @param candidate the candidate
+ * @param best the fastest candidate so far, replaced by the candidate if it is faster
+ * @param bestTime the time of best in seconds
+ */
+static void tryTuning(char *argv[], const Myvect_t *myVect, long threads,
+                      const Tuning_t *candidate, Tuning_t *best, double *bestTime) {
+  const Output_t output = {false, false, NULL, NULL, false, false, true};
+  double time = INFINITY;
+  for (int run = 0; run < PLAN_RUNS; ++run) {
+    Myvect_t copy;
+    init_myvect(&copy);
+    reserve_myvect(&copy, myVect->size);
+    memcpy(copy.data, myVect->data, sizeof(real_t) * myVect->size);
+    copy.size = myVect->size;
+
+    const double start = now();
+    if (runEngine(argv, &copy, &output, candidate, threads) != EXIT_SUCCESS) {
+      // a candidate that fails is never chosen
+      time = INFINITY;
+      break;
+    }
+    const double elapsed = now() - start;
+    time = elapsed < time ? elapsed : time;
+  }
+
+  fprintf(stderr, "Planned %zu values with %s, depth %ld, radix %zu: %.3f ms\n", myVect->size,
+          ENGINE_NAMES[candidate->engine], candidate->depth, candidate->radix, time * 1e3);
+  if (time < *bestTime) {
+    *best = *candidate;
+    *bestTime = time;
+  }
+}
+
+/**
+ * @brief Times the engines, depths and radices for the size of the input
+ *
+ * @detail The radix is chosen first with the sequential engine, and is then used for the slices
+ * of the other engines. The thread engine is tried with the depths that split down to each of
+ * PLAN_THREAD_CUTOFFS, the shm and process engines with every depth up to the given one, but at
+ * least one. Odd sizes cannot be split, so they are only transformed sequentially.
+ * @param argv argv of the current process
+ * @param myVect the input, which is not changed
+ * @param threads number of threads of the thread engine
+ * @param depth the deepest tree of processes that is tried
+ * @return the fastest candidate
+ */
+static Tuning_t planTransform(char *argv[], const Myvect_t *myVect, long threads, long depth) {
+  const size_t n = myVect->size;
+  Tuning_t best = {ENGINE_SEQUENTIAL, 0, 2};
+  double bestTime = INFINITY;
+  tryTuning(argv, myVect, threads, &best, &best, &bestTime);
+  if (is_power_of_two(n) && n >= 8) {
+    // the complex transform of the real input has n / 2 values
+    const Tuning_t candidate = {ENGINE_SEQUENTIAL, 0, 4};
+    tryTuning(argv, myVect, threads, &candidate, &best, &bestTime);
+  }
+  if (n % 2 != 0) {
+    return best;
+  }
+
+  const size_t radix = best.radix;
+  long previous = 0;
+  for (size_t i = 0; i < sizeof(PLAN_THREAD_CUTOFFS) / sizeof(PLAN_THREAD_CUTOFFS[0]); ++i) {
+    const Tuning_t candidate = {ENGINE_THREAD, splitDepth(n, PLAN_THREAD_CUTOFFS[i]), radix};
+    if (candidate.depth > 0 && candidate.depth != previous) {
+      tryTuning(argv, myVect, threads, &candidate, &best, &bestTime);
     }
+    previous = candidate.depth;
+  }
+  // one level even with a single core, processes may still overlap their I/O
+  const long deepest = depth > 1 ? depth : 1;
+  for (long levels = 1; levels <= deepest && levels <= splitDepth(n, 1); ++levels) {
+    const Tuning_t shm = {ENGINE_SHM, levels, radix};
+    tryTuning(argv, myVect, threads, &shm, &best, &bestTime);
+    const Tuning_t process = {ENGINE_PROCESS, levels, radix};
+    tryTuning(argv, myVect, threads, &process, &best, &bestTime);
+  }
+  return best;
+}
 
-    fprintf(stdout, "%f %f*i\n", result, resultImaginary);
-    // fprintf(stderr, "Wrote result number %zu! My pid is: %d\n", i, (int)getpid());
+/**
+ * @brief Times the inverse transform with both radices and returns the faster one
+ *
+ * @param data the input of the inverse transform, which is not changed
+ * @param n number of values
+ * @return the radix, see init_plan_radix()
+ */
+static size_t planInverse(const Complex_t *data, size_t n) {
+  if (!is_power_of_two(n) || n < 4) {
+    // the radix only matters for powers of two
+    return 2;
+  }
+
+  Complex_t *work = alloc_aligned(sizeof(Complex_t) * n);
+  size_t best = 2;
+  double bestTime = INFINITY;
+  for (size_t radix = 2; radix <= 4; radix += 2) {
+    Plan_t plan;
+    init_plan_radix(&plan, n, radix);
+    double time = INFINITY;
+    for (int run = 0; run < PLAN_RUNS; ++run) {
+      memcpy(work, data, sizeof(Complex_t) * n);
+      const double start = now();
+      execute_inverse_plan(&plan, work);
+      const double elapsed = now() - start;
+      time = elapsed < time ? elapsed : time;
+    }
+    free_plan(&plan);
+
+    fprintf(stderr, "Planned the inverse of %zu values with radix %zu: %.3f ms\n", n, radix,
+            time * 1e3);
+    if (time < bestTime) {
+      best = radix;
+      bestTime = time;
+    }
+  }
+  free(work);
+  return best;
+}
+
+/**
+ * @brief Stores the choice of the planner in the wisdom file
+ *
+ * @detail Also stores the biggest twiddle table in the twiddle file, so later runs map it.
+ * Terminates the application if a file cannot be written.
+ * @param argv argv of the current process
+ * @param planner the wisdom and its file
+ * @param n size of the transform
+ * @param inverse the direction of the transform
+ * @param tuning the choice
+ */
+static void savePlan(char *argv[], Planner_t *planner, size_t n, bool inverse,
+                     const Tuning_t *tuning) {
+  WisdomEntry_t entry = {n, inverse, "", "", tuning->depth, tuning->radix};
+  snprintf(entry.precision, sizeof(entry.precision), "%s", WISDOM_PRECISION);
+  snprintf(entry.engine, sizeof(entry.engine), "%s", ENGINE_NAMES[tuning->engine]);
+  put_wisdom(&planner->wisdom, &entry);
+  if (!save_wisdom(&planner->wisdom, planner->path)) {
+    fprintf(stderr, "%s ERROR cannot write wisdom file %s: %s\n", argv[0], planner->path,
+            strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+  // the transforms that were timed computed the twiddle tables of this size
+  if (!save_twiddles(planner->twiddle_path)) {
+    fprintf(stderr, "%s ERROR cannot write twiddle file %s: %s\n", argv[0],
+            planner->twiddle_path, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+}
+
+/**
+ * @brief Frees the wisdom of a planner and the name of its twiddle file
+ */
+static void freePlanner(Planner_t *planner) {
+  free_wisdom(&planner->wisdom);
+  free(planner->twiddle_path);
+  planner->twiddle_path = NULL;
+}
+
+/**
+ * @brief Looks up an engine by its name
+ *
+ * @param name the name, as for '-e'
+ * @param engine set to the engine if there is one with that name
+ * @return whether there is one
+ */
+static bool engineByName(const char *name, Engine_t *engine) {
+  for (size_t i = 0; i < WISDOM_ENGINE_COUNT; ++i) {
+    if (strcmp(name, ENGINE_NAMES[i]) == 0) {
+      *engine = (Engine_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Returns the radix the wisdom has for a size, or 2 if the size has not been planned
+ */
+static size_t plannedRadix(const Wisdom_t *wisdom, size_t n, bool inverse) {
+  const WisdomEntry_t *entry = find_wisdom(wisdom, n, inverse);
+  return entry != NULL ? entry->radix : 2;
+}
+
+/**
+ * @brief Returns true if a line only consists of white space
+ */
+static bool isBlank(const char *line) {
+  for (; *line != '\0'; ++line) {
+    if (!isspace((unsigned char)*line)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the next vectors of batch mode from stdin
+ *
+ * @detail Reads until the batch is full or the input ends, or until reading would wait while
+ * there are vectors to transform, so a slow stream gets its results as soon as possible. A
+ * vector that is still incomplete then is kept for the next batch. Terminates the application
+ * if a line cannot be parsed.
+ * @param argv argv of the current process
+ * @param batch the batch, whose previous vectors are replaced
+ * @param length values per vector, or 0 if vectors are separated by blank lines
+ * @param reader the reader of stdin
+ * @return true if at least one vector was read
+ */
+static bool readBatch(char *argv[], Batch_t *batch, size_t length, Reader_t *reader) {
+  // move the incomplete vector of the previous batch to the front
+  const size_t carried = batch->values.size - batch->starts[batch->count];
+  memmove(batch->values.data, batch->values.data + batch->starts[batch->count],
+          sizeof(real_t) * carried);
+  batch->values.size = carried;
+  batch->count = 0;
+  batch->starts[0] = 0;
+  char *line = NULL;
+  while (batch->count < BATCH_VECTORS && (batch->count == 0 || !would_block(reader)) &&
+         (line = read_line(reader)) != NULL) {
+    if (isBlank(line)) {
+      // with a fixed length blank lines are only decoration
+      if (length == 0 && batch->values.size > batch->starts[batch->count]) {
+        batch->starts[++batch->count] = batch->values.size;
+      }
+      continue;
+    }
+
+    real_t value;
+    if (!parseValue(line, &value)) {
+      fprintf(stderr, "%s Could not parse input value: %s\n", argv[0], line);
+      exit(EXIT_FAILURE);
+    }
+    push_myvect(&batch->values, value);
+    if (length != 0 && batch->values.size - batch->starts[batch->count] == length) {
+      batch->starts[++batch->count] = batch->values.size;
+    }
+  }
+
+  // the last vector does not need to be followed by a blank line
+  if (line == NULL && batch->values.size > batch->starts[batch->count]) {
+    if (length != 0) {
+      fprintf(stderr, "%s ERROR the last vector has less than %zu values\n", argv[0], length);
+      exit(EXIT_FAILURE);
+    }
+    batch->starts[++batch->count] = batch->values.size;
+  }
+  return batch->count > 0;
+}
+
+/**
+ * @brief Returns the index of the plan for vectors of size n, creating it if needed
+ *
+ * @detail Terminates the application if memory allocation fails.
+ */
+static size_t batchPlan(Batch_t *batch, size_t n) {
+  for (size_t i = 0; i < batch->plan_count; ++i) {
+    if (batch->plans[i].n == n) {
+      return i;
+    }
+  }
+
+  if (batch->plan_count == batch->plan_capacity) {
+    batch->plan_capacity = batch->plan_capacity == 0 ? 4 : 2 * batch->plan_capacity;
+    batch->plans = realloc(batch->plans, sizeof(RealPlan_t) * batch->plan_capacity);
+    if (unlikely(batch->plans == NULL)) {
+      // out of memory
+      exit(EXIT_FAILURE);
+    }
+  }
+  init_real_plan_radix(&batch->plans[batch->plan_count], n,
+                       plannedRadix(batch->wisdom, n, false));
+  return batch->plan_count++;
+}
+
+/**
+ * @brief Transforms the vectors of a task, spawning a task for half of them if there are many
+ *
+ * @detail Ranges of up to THREAD_CUTOFF values are transformed inline, like the slices of the
+ * thread engine.
+ * @param worker the worker running the task
+ * @param task a BatchTask_t
+ */
+static void transformBatchTask(Worker_t *worker, Task_t *task) {
+  const BatchTask_t *self = (BatchTask_t *)task;
+  const Batch_t *batch = self->batch;
+  if (self->end - self->begin == 1 ||
+      batch->starts[self->end] - batch->starts[self->begin] <= THREAD_CUTOFF) {
+    for (size_t i = self->begin; i < self->end; ++i) {
+      const size_t start = batch->starts[i];
+      const size_t n = batch->starts[i + 1] - start;
+      execute_real_plan(&batch->plans[batch->plan_indexes[i]], batch->values.data + start, 1,
+                        batch->results + start);
+      if (!self->half) {
+        expand_spectrum(batch->results + start, n);
+      }
+    }
+    return;
+  }
+
+  const size_t middle = self->begin + (self->end - self->begin) / 2;
+  BatchTask_t first = {{transformBatchTask, 0}, batch, self->begin, middle, self->half};
+  BatchTask_t second = {{transformBatchTask, 0}, batch, middle, self->end, self->half};
+  spawn_task(worker, &second.task);
+  run_task(worker, &first.task);
+  join_task(worker, &second.task);
+}
+
+/**
+ * @brief Transforms many vectors in one process
+ *
+ * @detail Reads up to BATCH_VECTORS vectors at a time, fewer if more input is not available yet,
+ * transforms them in parallel with a pool of threads and writes their results in input order,
+ * separated by blank lines. The workers sleep while the input is read. Plans and buffers
+ * are reused between vectors and batches. Terminates the application on invalid input.
+ * @param argv argv of the current process
+ * @param half whether to only write the n / 2 + 1 results of each vector that are not redundant
+ * @param accuracy whether to report the accuracy of each vector
+ * @param shortest whether to print the shortest digits that read back exactly
+ * @param length values per vector, or 0 if vectors are separated by blank lines
+ * @param threads number of threads, including the calling one
+ * @param planner the wisdom with the radix of each length
+ * @return EXIT_SUCCESS
+ */
+static int batchFFT(char *argv[], bool half, bool accuracy, bool shortest, size_t length,
+                    long threads, const Planner_t *planner) {
+  Batch_t batch;
+  init_myvect(&batch.values);
+  batch.count = 0;
+  batch.starts[0] = 0;
+  batch.wisdom = &planner->wisdom;
+  batch.results = NULL;
+  batch.results_capacity = 0;
+  batch.plans = NULL;
+  batch.plan_count = 0;
+  batch.plan_capacity = 0;
+
+  Pool_t pool;
+  start_pool(&pool, threads);
+
+  Reader_t reader;
+  init_reader(&reader, STDIN_FILENO);
+  bool first = true;
+  while (readBatch(argv, &batch, length, &reader)) {
+    if (batch.plan_count > BATCH_PLANS) {
+      // too many different lengths, don't keep all their plans around
+      for (size_t i = 0; i < batch.plan_count; ++i) {
+        free_real_plan(&batch.plans[i]);
+      }
+      batch.plan_count = 0;
+    }
+    for (size_t i = 0; i < batch.count; ++i) {
+      batch.plan_indexes[i] = batchPlan(&batch, batch.starts[i + 1] - batch.starts[i]);
+    }
+    if (batch.values.size > batch.results_capacity) {
+      free(batch.results);
+      batch.results_capacity = batch.values.size;
+      batch.results = alloc_aligned(sizeof(Complex_t) * batch.results_capacity);
+    }
+
+    BatchTask_t root = {{transformBatchTask, 0}, &batch, 0, batch.count, half};
+    run_task(main_worker(&pool), &root.task);
+
+    for (size_t i = 0; i < batch.count; ++i) {
+      const size_t start = batch.starts[i];
+      const Output_t output = {
+          false, half, accuracy ? batch.values.data + start : NULL, NULL, false, shortest, false};
+      if (!first) {
+        fputc('\n', stdout);
+      }
+      first = false;
+      writeResults(argv, batch.results + start, batch.starts[i + 1] - start, &output);
+    }
+    // the next batch may have to wait for input
+    fflush(stdout);
+  }
+
+  stop_pool(&pool);
+  free_reader(&reader);
+  for (size_t i = 0; i < batch.plan_count; ++i) {
+    free_real_plan(&batch.plans[i]);
+  }
+  free(batch.plans);
+  free(batch.results);
+  freedata_myvect(&batch.values);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Calculates the inverse FFT of complex values in process
+ *
+ * @detail Reads one value per line, as written by forkFFT, so the results of a forward
+ * transform can be transformed back. The radix of the plan comes from the wisdom, or from
+ * timing both if the planner measures. Terminates the application on invalid input.
+ * @param argv argv of the current process
+ * @param accuracy whether to report the accuracy of the results
+ * @param shortest whether to print the shortest digits that read back exactly
+ * @param planner the wisdom, and whether to plan the size of the input into it
+ * @return EXIT_SUCCESS or EXIT_FAILURE if there is no input
+ */
+static int inverseFFT(char *argv[], bool accuracy, bool shortest, Planner_t *planner) {
+  size_t n = 0, capacity = INITIAL_ARRAY_CAPACITY;
+  Complex_t *data = malloc(sizeof(Complex_t) * capacity);
+  if (unlikely(data == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+
+  Reader_t reader;
+  init_reader(&reader, STDIN_FILENO);
+  char *line;
+  while ((line = read_line(&reader)) != NULL) {
+    if (n == capacity) {
+      capacity *= 2;
+      data = realloc(data, sizeof(Complex_t) * capacity);
+      if (unlikely(data == NULL)) {
+        // out of memory
+        exit(EXIT_FAILURE);
+      }
+    }
+    if (!parseComplex(line, &data[n])) {
+      fprintf(stderr, "%s Could not parse input value: %s\n", argv[0], line);
+      exit(EXIT_FAILURE);
+    }
+    ++n;
+  }
+  free_reader(&reader);
+  if (n == 0) {
+    free(data);
+    return EXIT_FAILURE;
+  }
+
+  Complex_t *reference = NULL;
+  if (accuracy) {
+    reference = alloc_aligned(sizeof(Complex_t) * n);
+    memcpy(reference, data, sizeof(Complex_t) * n);
+  }
+
+  Tuning_t tuning = {ENGINE_SEQUENTIAL, 0, plannedRadix(&planner->wisdom, n, true)};
+  if (planner->measure) {
+    tuning.radix = planInverse(data, n);
+    savePlan(argv, planner, n, true, &tuning);
+  }
+  Plan_t plan;
+  init_plan_radix(&plan, n, tuning.radix);
+  execute_inverse_plan(&plan, data);
+  free_plan(&plan);
+
+  const Output_t output = {false, false, NULL, reference, true, shortest, false};
+  writeResults(argv, data, n, &output);
+  free(reference);
+  free(data);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Calculates a short-time Fourier transform of an unbounded stream of values
+ *
+ * @detail Each frame of values is multiplied by the window and transformed. Its results are
+ * written and flushed right away, separated by a blank line from those of the previous frame.
+ * The next frame starts hop values later, so frames overlap if hop < frame. Only one frame is
+ * kept in memory, and all frames share one plan. Values after the last whole frame are ignored.
+ * Blank lines are ignored as well. Terminates the application on invalid input.
+ * @param argv argv of the current process
+ * @param half whether to only write the frame / 2 + 1 results that are not redundant
+ * @param accuracy whether to report the accuracy of each frame
+ * @param shortest whether to print the shortest digits that read back exactly
+ * @param frame values per frame
+ * @param hop values from the start of one frame to the start of the next
+ * @param window the window function
+ * @param planner the wisdom with the radix of the frame size
+ * @return EXIT_SUCCESS
+ */
+static int stftFFT(char *argv[], bool half, bool accuracy, bool shortest, size_t frame,
+                   size_t hop, Window_t window, const Planner_t *planner) {
+  // the values of the current frame, their windowed copy and the window itself
+  Arena_t arena;
+  init_arena(&arena, ARENA_BLOCK_SIZE(sizeof(real_t) * 3 * frame) +
+                         ARENA_BLOCK_SIZE(sizeof(Complex_t) * frame));
+  real_t *values = alloc_arena(&arena, sizeof(real_t) * 3 * frame);
+  Complex_t *results = alloc_arena(&arena, sizeof(Complex_t) * frame);
+  real_t *windowed = values + frame;
+  real_t *coefficients = values + 2 * frame;
+  compute_window(coefficients, frame, window);
+
+  RealPlan_t plan;
+  init_real_plan_radix(&plan, frame, plannedRadix(&planner->wisdom, frame, false));
+
+  Reader_t reader;
+  init_reader(&reader, STDIN_FILENO);
+  char *line;
+  size_t count = 0, skip = 0;
+  bool first = true;
+  while ((line = read_line(&reader)) != NULL) {
+    if (isBlank(line)) {
+      continue;
+    }
+    real_t value;
+    if (!parseValue(line, &value)) {
+      fprintf(stderr, "%s Could not parse input value: %s\n", argv[0], line);
+      exit(EXIT_FAILURE);
+    }
+    if (skip > 0) {
+      // between frames that do not overlap
+      --skip;
+      continue;
+    }
+
+    values[count++] = value;
+    if (count < frame) {
+      continue;
+    }
+
+    for (size_t k = 0; k < frame; ++k) {
+      windowed[k] = values[k] * coefficients[k];
+    }
+    execute_real_plan(&plan, windowed, 1, results);
+    if (!half) {
+      expand_spectrum(results, frame);
+    }
+    if (!first) {
+      fputc('\n', stdout);
+    }
+    first = false;
+    const Output_t output = {false, half, accuracy ? windowed : NULL, NULL, false, shortest,
+                             false};
+    writeResults(argv, results, frame, &output);
+    fflush(stdout);
+
+    if (hop < frame) {
+      memmove(values, values + hop, sizeof(real_t) * (frame - hop));
+      count = frame - hop;
+    } else {
+      count = 0;
+      skip = hop - frame;
+    }
   }
 
+  free_reader(&reader);
+  free_real_plan(&plan);
+  free_arena(&arena);
   return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** @defgroup Gensignal */
+
+/** @addtogroup Gensignal
+ * @brief Generates input for testing and benchmarking forkFFT.
+ *
+ * @details Writes n real values to stdout, one per line, which forkFFT reads as they are.
+ * Besides random values there are structured signals whose spectra are known: an impulse has
+ * a flat spectrum, a constant and an alternating signal only have one bin, and a sine has two.
+ * Values are printed with enough digits to read back to the same double, so a checker can
+ * compute the exact reference from the same file.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+typedef enum signalKind {
+  SIGNAL_RANDOM,
+  SIGNAL_IMPULSE,
+  SIGNAL_CONSTANT,
+  SIGNAL_ALTERNATING,
+  SIGNAL_SINE,
+  SIGNAL_CHIRP
+} SignalKind_t;
+
+static void printUsage(char *name);
+static unsigned long parseNumber(char *name, char option, const char *arg);
+static double signalValue(SignalKind_t kind, unsigned long i, unsigned long n,
+                          unsigned long frequency);
+
+int main(int argc, char *argv[]) {
+  unsigned long n = 1024;
+  SignalKind_t kind = SIGNAL_RANDOM;
+  unsigned long frequency = 3;
+  unsigned long seed = 1;
+
+  // parse arguments
+  {
+    const char *optstring = "n:k:f:r:";
+    int c;
+
+    // getopt returns -1 if there is no more character
+    // Or it returns '?' in case of unknown option or missing option argument
+    while ((c = getopt(argc, argv, optstring)) != -1) {
+      switch (c) {
+      case 'n': {
+        n = parseNumber(argv[0], c, optarg);
+      } break;
+      case 'k': {
+        if (strcmp(optarg, "random") == 0) {
+          kind = SIGNAL_RANDOM;
+        } else if (strcmp(optarg, "impulse") == 0) {
+          kind = SIGNAL_IMPULSE;
+        } else if (strcmp(optarg, "constant") == 0) {
+          kind = SIGNAL_CONSTANT;
+        } else if (strcmp(optarg, "alternating") == 0) {
+          kind = SIGNAL_ALTERNATING;
+        } else if (strcmp(optarg, "sine") == 0) {
+          kind = SIGNAL_SINE;
+        } else if (strcmp(optarg, "chirp") == 0) {
+          kind = SIGNAL_CHIRP;
+        } else {
+          fprintf(stderr, "[%s, %s, %d] ERROR unknown signal %s \n", argv[0], __FILE__,
+                  __LINE__, optarg);
+          printUsage(argv[0]);
+          exit(EXIT_FAILURE);
+        }
+      } break;
+      case 'f': {
+        frequency = parseNumber(argv[0], c, optarg);
+      } break;
+      case 'r': {
+        seed = parseNumber(argv[0], c, optarg);
+      } break;
+      case '?': {
+        fprintf(stderr, "[%s, %s, %d] ERROR unknown option or missing argument \n", argv[0],
+                __FILE__, __LINE__);
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+      } break;
+      default:
+        assert(0 && "We should never reach this if the optstring is valid");
+      }
+    }
+
+    if (optind != argc) {
+      fprintf(stderr, "[%s, %s, %d] ERROR no positional arguments expected \n", argv[0],
+              __FILE__, __LINE__);
+      printUsage(argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  srandom(seed);
+
+  for (unsigned long i = 0; i < n; ++i) {
+    printf("%.17g\n", signalValue(kind, i, n, frequency));
+  }
+
+  if (fflush(stdout) != 0) {
+    fprintf(stderr, "[%s, %s, %d] ERROR writing failed: %s\n", argv[0], __FILE__, __LINE__,
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Prints help including arguments of this program to stderr.
+ *
+ * @param name c_string of the name of the executable
+ */
+static void printUsage(char *name) {
+  fprintf(stderr, "\nUsage:\n\n");
+  fprintf(stderr, "%s [-n values] [-k random|impulse|constant|alternating|sine|chirp] "
+                  "[-f frequency] [-r seed]\n",
+          name);
+  fprintf(stderr, "\t-n number of values, default 1024\n");
+  fprintf(stderr, "\t-k the signal, default random values between -1 and 1\n");
+  fprintf(stderr, "\t-f periods of the sine in all values, default 3\n");
+  fprintf(stderr, "\t-r seed of the random number generator, default 1\n");
+}
+
+/**
+ * @brief Parses a non negative integer or terminates the application.
+ */
+static unsigned long parseNumber(char *name, char option, const char *arg) {
+  char *end_pointer;
+  errno = 0;
+  const unsigned long number = strtoul(arg, &end_pointer, 10);
+  if (errno != 0 || *end_pointer != '\0' || arg[0] == '-') {
+    fprintf(stderr, "[%s, %s, %d] ERROR '-%c' expects a number \n", name, __FILE__, __LINE__,
+            option);
+    printUsage(name);
+    exit(EXIT_FAILURE);
+  }
+  return number;
+}
+
+/**
+ * @brief Returns value i of n of a signal
+ *
+ * @detail The chirp sweeps from 0 to half the sampling rate, so it touches every bin.
+ */
+static double signalValue(SignalKind_t kind, unsigned long i, unsigned long n,
+                          unsigned long frequency) {
+  const double pi = acos(-1.0);
+  switch (kind) {
+  case SIGNAL_RANDOM:
+    return 2.0 * random() / ((double)RAND_MAX + 1) - 1.0;
+  case SIGNAL_IMPULSE:
+    return i == 0 ? 1.0 : 0.0;
+  case SIGNAL_CONSTANT:
+    return 1.0;
+  case SIGNAL_ALTERNATING:
+    return i % 2 == 0 ? 1.0 : -1.0;
+  case SIGNAL_SINE:
+    return sin(2.0 * pi * (double)(frequency * i % n) / n);
+  case SIGNAL_CHIRP:
+    return cos(pi * (double)i * i / (2.0 * n));
+  }
+  assert(0 && "We should never reach this with a valid signal");
+  return 0;
+}
+
+/** @}*/
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/** @defgroup Pool */
+
+/** @addtogroup Pool
+ * @brief A pool of threads that steal work from each other
+ *
+ * @details Every worker has a deque of tasks it spawned. It runs them itself from the bottom,
+ * in depth first order like a plain recursion would, while idle workers steal from the top,
+ * which are the biggest tasks. Joining a task that has been stolen does not block, the worker
+ * helps with other tasks until it is done. A worker that finds no task to run sleeps until a
+ * task is spawned, or until the task it joins is done. The thread that starts the pool is
+ * worker 0.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+#include "pool.h"
+#include "tools.h"
+
+/**
+ * @brief Takes the task spawned last from the bottom of a worker's own deque
+ *
+ * @return the task, or NULL if the deque is empty
+ */
+static Task_t *popTask(Worker_t *worker) {
+  Deque_t *deque = &worker->deque;
+  Task_t *task = NULL;
+  pthread_mutex_lock(&deque->mutex);
+  if (deque->bottom > deque->top) {
+    task = deque->tasks[--deque->bottom % DEQUE_CAPACITY];
+    __atomic_sub_fetch(&worker->pool->pending, 1, __ATOMIC_SEQ_CST);
+  }
+  pthread_mutex_unlock(&deque->mutex);
+  return task;
+}
+
+/**
+ * @brief Takes the oldest task from the top of another worker's deque
+ *
+ * @return the task, or NULL if the deque is empty
+ */
+static Task_t *stealTask(Worker_t *victim) {
+  Deque_t *deque = &victim->deque;
+  Task_t *task = NULL;
+  pthread_mutex_lock(&deque->mutex);
+  if (deque->bottom > deque->top) {
+    task = deque->tasks[deque->top++ % DEQUE_CAPACITY];
+    task->stolen = 1;
+    __atomic_sub_fetch(&victim->pool->pending, 1, __ATOMIC_SEQ_CST);
+  }
+  pthread_mutex_unlock(&deque->mutex);
+  return task;
+}
+
+/**
+ * @brief Finds some task to run, first in the own deque, then in a random other one
+ *
+ * @return the task, or NULL if none was found
+ */
+static Task_t *findTask(Worker_t *worker) {
+  Task_t *task = popTask(worker);
+  const size_t count = worker->pool->count;
+  if (task == NULL && count > 1) {
+    const size_t victim = (worker->index + 1 + rand_r(&worker->seed) % (count - 1)) % count;
+    task = stealTask(&worker->pool->workers[victim]);
+  }
+  return task;
+}
+
+/**
+ * @brief Wakes the sleeping workers, if there are any
+ *
+ * @detail The caller has published a task or its completion before, and a worker only sleeps
+ * after announcing it in sleeping and finding nothing to do, so one of both sees the other.
+ * @param pool the pool
+ * @param all whether to wake every worker, or one to take a new task
+ */
+static void wakeWorkers(Pool_t *pool, bool all) {
+  if (likely(__atomic_load_n(&pool->sleeping, __ATOMIC_SEQ_CST) == 0)) {
+    return;
+  }
+  pthread_mutex_lock(&pool->mutex);
+  if (all) {
+    pthread_cond_broadcast(&pool->wakeup);
+  } else {
+    pthread_cond_signal(&pool->wakeup);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Sleeps until a task is pending, the joined task is done or the pool is stopped
+ *
+ * @param pool the pool
+ * @param joined the task the worker joins, or NULL
+ */
+static void waitForWork(Pool_t *pool, const Task_t *joined) {
+  pthread_mutex_lock(&pool->mutex);
+  __atomic_add_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) == 0 &&
+         !__atomic_load_n(&pool->shutdown, __ATOMIC_SEQ_CST) &&
+         (joined == NULL || !__atomic_load_n(&joined->done, __ATOMIC_SEQ_CST))) {
+    pthread_cond_wait(&pool->wakeup, &pool->mutex);
+  }
+  __atomic_sub_fetch(&pool->sleeping, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Runs a task that was spawned and marks it as done
+ *
+ * @detail If the task was stolen, wakes the workers, as the one that spawned it may sleep until
+ * it is done.
+ * @param worker the worker running the task
+ * @param task the task
+ */
+static void runSpawned(Worker_t *worker, Task_t *task) {
+  task->run(worker, task);
+  // the task may go away as soon as it is done
+  const int stolen = task->stolen;
+  __atomic_store_n(&task->done, 1, __ATOMIC_SEQ_CST);
+  if (stolen) {
+    wakeWorkers(worker->pool, true);
+  }
+}
+
+/**
+ * @brief Runs a task that was not spawned and marks it as done
+ *
+ * @param worker the worker running the task
+ * @param task the task
+ */
+void run_task(Worker_t *worker, Task_t *task) {
+  task->done = 0;
+  task->stolen = 0;
+  runSpawned(worker, task);
+}
+
+/**
+ * @brief Makes a task available to be run by this or any other worker
+ *
+ * @detail Must be joined by the same worker before the task's memory goes away. If the deque is
+ * full the task is run right away.
+ * @param worker the worker spawning the task
+ * @param task the task
+ */
+void spawn_task(Worker_t *worker, Task_t *task) {
+  Deque_t *deque = &worker->deque;
+  task->done = 0;
+  task->stolen = 0;
+  pthread_mutex_lock(&deque->mutex);
+  if (deque->bottom - deque->top < DEQUE_CAPACITY) {
+    deque->tasks[deque->bottom++ % DEQUE_CAPACITY] = task;
+    __atomic_add_fetch(&worker->pool->pending, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&deque->mutex);
+    wakeWorkers(worker->pool, false);
+    return;
+  }
+  pthread_mutex_unlock(&deque->mutex);
+  runSpawned(worker, task);
+}
+
+/**
+ * @brief Waits until a spawned task is done, running it or other tasks in the meantime
+ *
+ * @param worker the worker that spawned the task
+ * @param task the task
+ */
+void join_task(Worker_t *worker, Task_t *task) {
+  while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+    // everything spawned after the task has been joined already, so if the task has not been
+    // stolen it is at the bottom
+    Task_t *next = findTask(worker);
+    if (next != NULL) {
+      runSpawned(worker, next);
+    } else {
+      // the task was stolen and runs on another worker
+      waitForWork(worker->pool, task);
+    }
+  }
+}
+
+/**
+ * @brief Main loop of the workers except worker 0, running tasks until the pool is stopped
+ */
+static void *workerMain(void *arg) {
+  Worker_t *worker = arg;
+  while (!__atomic_load_n(&worker->pool->shutdown, __ATOMIC_ACQUIRE)) {
+    Task_t *task = findTask(worker);
+    if (task != NULL) {
+      runSpawned(worker, task);
+    } else {
+      waitForWork(worker->pool, NULL);
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Starts count - 1 threads, the calling thread is the first worker
+ *
+ * @detail Terminates the application if memory allocation or starting a thread fails.
+ * @param pool The pool to be initialized
+ * @param count number of workers, at least 1
+ */
+void start_pool(Pool_t *pool, size_t count) {
+  pool->count = count;
+  pool->shutdown = 0;
+  pool->pending = 0;
+  pool->sleeping = 0;
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->wakeup, NULL);
+  pool->workers = malloc(sizeof(Worker_t) * count);
+  pool->threads = malloc(sizeof(pthread_t) * count);
+  if (unlikely(pool->workers == NULL || pool->threads == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    Worker_t *worker = &pool->workers[i];
+    worker->pool = pool;
+    worker->index = i;
+    worker->seed = i + 1;
+    worker->deque.top = 0;
+    worker->deque.bottom = 0;
+    pthread_mutex_init(&worker->deque.mutex, NULL);
+  }
+  for (size_t i = 1; i < count; ++i) {
+    if (pthread_create(&pool->threads[i], NULL, workerMain, &pool->workers[i]) != 0) {
+      fprintf(stderr, "ERROR cannot start thread\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+/**
+ * @brief Returns the worker of the thread that started the pool
+ */
+Worker_t *main_worker(Pool_t *pool) { return &pool->workers[0]; }
+
+/**
+ * @brief Stops and frees a pool
+ *
+ * @detail All tasks must have been joined. Do not reuse the pool afterwards.
+ * @param pool The pool
+ */
+void stop_pool(Pool_t *pool) {
+  __atomic_store_n(&pool->shutdown, 1, __ATOMIC_SEQ_CST);
+  wakeWorkers(pool, true);
+  for (size_t i = 1; i < pool->count; ++i) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  for (size_t i = 0; i < pool->count; ++i) {
+    pthread_mutex_destroy(&pool->workers[i].deque.mutex);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->wakeup);
+  free(pool->workers);
+  free(pool->threads);
+  pool->count = 0;
+}
+
+/** @}*/
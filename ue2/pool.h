@@ -0,0 +1,58 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Tasks one worker can have spawned and not yet joined, more are run right away */
+#define DEQUE_CAPACITY 64
+
+typedef struct worker Worker_t;
+typedef struct task Task_t;
+
+/** Runs a task, which may spawn and join more tasks on the worker */
+typedef void (*TaskFunction_t)(Worker_t *worker, Task_t *task);
+
+struct task {
+  TaskFunction_t run;
+  /** set once run has returned */
+  int done;
+  /** set if another worker than the spawning one took the task */
+  int stolen;
+};
+
+/** The tasks of one worker. It takes them from the bottom, thieves from the top. */
+typedef struct deque {
+  Task_t *tasks[DEQUE_CAPACITY];
+  size_t top;
+  size_t bottom;
+  pthread_mutex_t mutex;
+} Deque_t;
+
+struct worker {
+  struct pool *pool;
+  size_t index;
+  Deque_t deque;
+  /** state of the random number generator that picks whom to steal from */
+  unsigned seed;
+};
+
+typedef struct pool {
+  Worker_t *workers;
+  pthread_t *threads;
+  size_t count;
+  int shutdown;
+  /** tasks in all deques, which idle workers could take */
+  size_t pending;
+  /** workers waiting on wakeup for a task to be spawned, or one they joined to be done */
+  size_t sleeping;
+  pthread_mutex_t mutex;
+  pthread_cond_t wakeup;
+} Pool_t;
+
+void start_pool(Pool_t *pool, size_t count);
+Worker_t *main_worker(Pool_t *pool);
+void spawn_task(Worker_t *worker, Task_t *task);
+void join_task(Worker_t *worker, Task_t *task);
+void run_task(Worker_t *worker, Task_t *task);
+void stop_pool(Pool_t *pool);
@@ -0,0 +1,434 @@
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @defgroup TextIO */
+
+/** @addtogroup TextIO
+ * @brief Reads and writes the text format of forkFFT quickly
+ *
+ * @details Input is read in blocks of up to READER_BLOCK_SIZE bytes and split into lines in
+ * place, instead of one getline() call per value. Reads return what is available, so streams
+ * are processed as they arrive. The same reader reads binary input from parent processes.
+ * Most numbers are parsed by a fast path that is exact whenever it is taken: up to 19
+ * significant digits are collected in an integer, which is scaled by an exact power of ten in
+ * double, so there is only one rounding (Clinger's fast path). Everything else, like more
+ * digits, big exponents, hex floats, inf and nan, is left to strtof(), strtod() or strtold().
+ * Results are formatted into chunks of WRITER_CHUNK_SIZE bytes. The default format prints the
+ * same digits as "%f", from the value scaled by 10^6 and rounded to an integer, which is exact
+ * for float. The shortest format prints the fewest significant digits that read back to the
+ * same value.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+#include "textio.h"
+
+#if defined(REAL_LONG_DOUBLE)
+/** %g precisions to try for the shortest format, every value needs at least the first one */
+#define SHORTEST_MIN_DIGITS 18
+#define SHORTEST_MAX_DIGITS 21
+#elif defined(REAL_DOUBLE)
+#define SHORTEST_MIN_DIGITS 15
+#define SHORTEST_MAX_DIGITS 17
+#else
+#define SHORTEST_MIN_DIGITS 6
+#define SHORTEST_MAX_DIGITS 9
+#endif
+
+/** Every formatted number fits into this many bytes, longer ones bypass the chunk */
+#define MAX_NUMBER_LENGTH 64
+
+/**
+ * @brief Initializes a reader
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @param reader The reader to be initialized
+ * @param fd the file descriptor that is read, nothing else may read it
+ */
+void init_reader(Reader_t *reader, int fd) {
+  reader->fd = fd;
+  reader->capacity = READER_BLOCK_SIZE + 1;
+  reader->buffer = malloc(reader->capacity);
+  if (unlikely(reader->buffer == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  reader->begin = 0;
+  reader->end = 0;
+  reader->eof = false;
+}
+
+/**
+ * @brief Reads whatever is available behind the data in the buffer
+ *
+ * @detail Moves the data that has not been returned yet to the front first, and grows the
+ * buffer if less than half a block is free. Sets eof at the end of the input, or if reading
+ * fails. Terminates the application if memory allocation fails.
+ */
+static void fillBuffer(Reader_t *reader) {
+  const size_t left = reader->end - reader->begin;
+  memmove(reader->buffer, reader->buffer + reader->begin, left);
+  reader->begin = 0;
+  reader->end = left;
+  if (reader->capacity - 1 - reader->end < READER_BLOCK_SIZE / 2) {
+    reader->capacity = 2 * reader->capacity - 1;
+    reader->buffer = realloc(reader->buffer, reader->capacity);
+    if (unlikely(reader->buffer == NULL)) {
+      // out of memory
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  ssize_t count;
+  do {
+    count = read(reader->fd, reader->buffer + reader->end, reader->capacity - 1 - reader->end);
+  } while (count == -1 && errno == EINTR);
+  if (count <= 0) {
+    reader->eof = true;
+  } else {
+    reader->end += count;
+  }
+}
+
+/**
+ * @brief Returns the next line
+ *
+ * @detail The line break is replaced by '\0', so the line can be parsed like a string. It stays
+ * valid until the next call. Lines longer than the buffer make it grow. Terminates the
+ * application if memory allocation fails.
+ * @param reader the reader
+ * @return the line without its line break, or NULL at the end of the stream
+ */
+char *read_line(Reader_t *reader) {
+  while (true) {
+    char *const begin = reader->buffer + reader->begin;
+    char *const newline = memchr(begin, '\n', reader->end - reader->begin);
+    if (newline != NULL) {
+      *newline = '\0';
+      reader->begin = newline + 1 - reader->buffer;
+      return begin;
+    }
+    if (reader->eof) {
+      if (reader->begin == reader->end) {
+        return NULL;
+      }
+      // the last line has no line break, there is always room for the '\0'
+      reader->buffer[reader->end] = '\0';
+      reader->begin = reader->end;
+      return begin;
+    }
+
+    // keep the start of the current line and read more behind it
+    fillBuffer(reader);
+  }
+}
+
+/**
+ * @brief Returns whether read_line() would have to wait for input
+ *
+ * @detail That is the case if no complete line is buffered, the input has not ended and nothing
+ * can be read from it right now. Does not read anything.
+ * @param reader the reader
+ * @return true if the next line is not available yet
+ */
+bool would_block(Reader_t *reader) {
+  const char *const begin = reader->buffer + reader->begin;
+  if (reader->eof || memchr(begin, '\n', reader->end - reader->begin) != NULL) {
+    return false;
+  }
+  struct pollfd input = {reader->fd, POLLIN, 0};
+  int ready;
+  do {
+    ready = poll(&input, 1, 0);
+  } while (ready == -1 && errno == EINTR);
+  return ready == 0;
+}
+
+/**
+ * @brief Returns the next byte without consuming it
+ *
+ * @param reader the reader
+ * @return the byte, or EOF at the end of the input
+ */
+int peek_byte(Reader_t *reader) {
+  if (reader->begin == reader->end && !reader->eof) {
+    fillBuffer(reader);
+  }
+  return reader->begin < reader->end ? (unsigned char)reader->buffer[reader->begin] : EOF;
+}
+
+/**
+ * @brief Estimates how many lines are left in the input, without consuming any
+ *
+ * @detail Counts the lines in the buffer, which is exact if the whole input is buffered.
+ * Otherwise the count is extrapolated to the rest of the input, whose size is only known if it
+ * is a regular file, with a little to spare.
+ * @param reader the reader
+ * @return the estimate, or 0 if nothing is known about the size
+ */
+size_t estimate_lines(Reader_t *reader) {
+  peek_byte(reader);
+  const char *const begin = reader->buffer + reader->begin;
+  const char *const end = reader->buffer + reader->end;
+  size_t lines = 0;
+  for (const char *p = begin; p < end && (p = memchr(p, '\n', end - p)) != NULL; ++p) {
+    ++lines;
+  }
+  if (reader->eof) {
+    // the last line may not be terminated
+    return lines + 1;
+  }
+
+  struct stat info;
+  const off_t position = lseek(reader->fd, 0, SEEK_CUR);
+  if (lines == 0 || position == -1 || fstat(reader->fd, &info) == -1 ||
+      !S_ISREG(info.st_mode) || info.st_size < position) {
+    return 0;
+  }
+  const double left = (double)(info.st_size - position) + (end - begin);
+  return (size_t)(left / (end - begin) * lines * 1.0625) + 1;
+}
+
+/**
+ * @brief Reads exactly length raw bytes
+ *
+ * @param reader the reader
+ * @param data where the bytes are stored
+ * @param length number of bytes
+ * @return true on success, false if the input ends early
+ */
+bool read_bytes(Reader_t *reader, void *data, size_t length) {
+  char *out = data;
+  while (length > 0) {
+    if (reader->begin == reader->end) {
+      if (reader->eof) {
+        return false;
+      }
+      if (length >= READER_BLOCK_SIZE / 2) {
+        // big reads go straight to their destination instead of through the buffer
+        return read_all(reader->fd, out, length) == 0;
+      }
+      fillBuffer(reader);
+      continue;
+    }
+    const size_t available = reader->end - reader->begin;
+    const size_t count = available < length ? available : length;
+    memcpy(out, reader->buffer + reader->begin, count);
+    reader->begin += count;
+    out += count;
+    length -= count;
+  }
+  return true;
+}
+
+/**
+ * @brief Frees the buffer of a reader
+ *
+ * @param reader The reader
+ */
+void free_reader(Reader_t *reader) {
+  free(reader->buffer);
+  reader->buffer = NULL;
+  reader->capacity = 0;
+}
+
+/**
+ * @brief Parses a number like strtof(), strtod() or strtold(), depending on real_t
+ *
+ * @detail Returns the same value as those, but parses plain decimal numbers without calling
+ * them.
+ * @param text the number, followed by anything that is not part of it
+ * @param end is set to the first character behind the number, or to text if there is none
+ * @return the number
+ */
+real_t parse_real(const char *text, char **end) {
+#if !defined(REAL_LONG_DOUBLE)
+  // the powers of ten that are exact in double
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *p = text;
+  const bool negative = *p == '-';
+  if (*p == '-' || *p == '+') {
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int significant = 0, exponent = 0;
+  bool anyDigit = false;
+  for (; *p >= '0' && *p <= '9'; ++p) {
+    anyDigit = true;
+    mantissa = 10 * mantissa + (*p - '0');
+    significant += mantissa != 0;
+  }
+  if (*p == '.') {
+    for (++p; *p >= '0' && *p <= '9'; ++p) {
+      anyDigit = true;
+      mantissa = 10 * mantissa + (*p - '0');
+      significant += mantissa != 0;
+      --exponent;
+    }
+  }
+  if (*p == 'e' || *p == 'E') {
+    const char *e = p + 1;
+    const bool negativeExponent = *e == '-';
+    if (*e == '-' || *e == '+') {
+      ++e;
+    }
+    int value = 0;
+    const char *digits = e;
+    for (; *e >= '0' && *e <= '9' && value < 1000; ++e) {
+      value = 10 * value + (*e - '0');
+    }
+    if (e == digits || (*e >= '0' && *e <= '9')) {
+      // "1e" is 1 followed by 'e', and huge exponents are left to the slow path
+      significant = 20;
+    }
+    exponent += negativeExponent ? -value : value;
+    p = e;
+  }
+
+  // hex floats start like the number 0
+  if (anyDigit && significant <= 19 && *p != 'x' && *p != 'X' &&
+      mantissa <= (uint64_t)1 << 53 && exponent >= -22 && exponent <= 22) {
+    // mantissa and the power are exact, so this is the only rounding
+    double value = exponent < 0 ? mantissa / powers[-exponent] : mantissa * powers[exponent];
+    value = negative ? -value : value;
+#if defined(REAL_DOUBLE)
+    *end = (char *)p;
+    return value;
+#else
+    // rounding to double first may not round to the nearest float, but only if the double is
+    // exactly halfway between two floats
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x1fffffff) != 0x10000000) {
+      *end = (char *)p;
+      return value;
+    }
+#endif
+  }
+#endif
+  return strtoreal(text, end);
+}
+
+/**
+ * @brief Formats a value like "%f" and returns the length, or 0 if it does not fit into space
+ */
+static size_t formatFixed(char *out, size_t space, real_t value) {
+#if !defined(REAL_LONG_DOUBLE)
+  const double scaled = (double)value * 1e6;
+  // integers up to 2^53 are exact, which excludes inf and nan as well
+  if (fabs(scaled) < 9007199254740992.0) {
+    const double rounded = nearbyint(scaled);
+    bool exact = true;
+#if defined(REAL_DOUBLE)
+    // the product of a float and 10^6 is exact in double, that of a double may be rounded
+    const double error = fma(value, 1e6, -scaled);
+    exact = error == 0 || fabs(scaled - rounded) + fabs(error) < 0.5;
+#endif
+    if (exact) {
+      uint64_t magnitude = (uint64_t)fabs(rounded);
+      char digits[24];
+      size_t count = 0;
+      // the six decimals, the point and at least one digit before it
+      for (; count < 6; ++count) {
+        digits[count] = '0' + magnitude % 10;
+        magnitude /= 10;
+      }
+      digits[count++] = '.';
+      do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+      } while (magnitude > 0);
+
+      size_t length = 0;
+      // "%f" keeps the sign of values that round to zero
+      if (signbit(value)) {
+        out[length++] = '-';
+      }
+      while (count > 0) {
+        out[length++] = digits[--count];
+      }
+      return length;
+    }
+  }
+#endif
+  const int length = snprintf(out, space, "%" REAL_PRINTF_MODIFIER "f", value);
+  return (size_t)length < space ? (size_t)length : 0;
+}
+
+/**
+ * @brief Formats a value with the fewest significant digits that read back to the same value
+ *
+ * @return the length, or 0 if it does not fit into space
+ */
+static size_t formatShortest(char *out, size_t space, real_t value) {
+  int length = 0;
+  for (int precision = SHORTEST_MIN_DIGITS; precision <= SHORTEST_MAX_DIGITS; ++precision) {
+    length = snprintf(out, space, "%.*" REAL_PRINTF_MODIFIER "g", precision, value);
+    if ((size_t)length >= space || strtoreal(out, NULL) == value || isnan(value)) {
+      break;
+    }
+  }
+  return (size_t)length < space ? (size_t)length : 0;
+}
+
+/**
+ * @brief Formats a value with formatFixed() or formatShortest()
+ *
+ * @detail Numbers that do not fit into MAX_NUMBER_LENGTH bytes, which are only huge ones, are
+ * written to the stream directly, after the chunk.
+ * @return the new length of the chunk
+ */
+static size_t appendReal(FILE *stream, char *chunk, size_t length, real_t value, bool shortest) {
+  const size_t formatted = shortest ? formatShortest(chunk + length, MAX_NUMBER_LENGTH, value)
+                                    : formatFixed(chunk + length, MAX_NUMBER_LENGTH, value);
+  if (formatted > 0) {
+    return length + formatted;
+  }
+  fwrite(chunk, 1, length, stream);
+  if (shortest) {
+    fprintf(stream, "%.*" REAL_PRINTF_MODIFIER "g", SHORTEST_MAX_DIGITS, value);
+  } else {
+    fprintf(stream, "%" REAL_PRINTF_MODIFIER "f", value);
+  }
+  return 0;
+}
+
+/**
+ * @brief Writes complex values as lines of "re im*i"
+ *
+ * @detail The default format is "%f %f*i".
+ * @param stream the stream
+ * @param values the values
+ * @param count number of values
+ * @param shortest prints the fewest digits that read back to the same values instead
+ */
+void write_complex(FILE *stream, const Complex_t *values, size_t count, bool shortest) {
+  char chunk[WRITER_CHUNK_SIZE];
+  size_t length = 0;
+  for (size_t i = 0; i < count; ++i) {
+    // room for two numbers, the separators and the line break
+    if (WRITER_CHUNK_SIZE - length < 2 * MAX_NUMBER_LENGTH + 4) {
+      fwrite(chunk, 1, length, stream);
+      length = 0;
+    }
+    length = appendReal(stream, chunk, length, values[i].re, shortest);
+    chunk[length++] = ' ';
+    length = appendReal(stream, chunk, length, values[i].im, shortest);
+    memcpy(chunk + length, "*i\n", 3);
+    length += 3;
+  }
+  fwrite(chunk, 1, length, stream);
+}
+
+/** @}*/
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "fft.h"
+#include "tools.h"
+
+/** Bytes the reader asks for at once, it takes what is available right away */
+#define READER_BLOCK_SIZE (1 << 20)
+
+/** Bytes the writer formats before it hands them to its stream */
+#define WRITER_CHUNK_SIZE (1 << 16)
+
+/** Reads lines, or raw bytes, from a file descriptor in big blocks */
+typedef struct reader {
+  int fd;
+  char *buffer;
+  /** size of buffer, including one byte to terminate the last line */
+  size_t capacity;
+  /** the data that has not been returned yet is buffer[begin .. end) */
+  size_t begin;
+  size_t end;
+  bool eof;
+} Reader_t;
+
+void init_reader(Reader_t *reader, int fd);
+char *read_line(Reader_t *reader);
+bool would_block(Reader_t *reader);
+int peek_byte(Reader_t *reader);
+size_t estimate_lines(Reader_t *reader);
+bool read_bytes(Reader_t *reader, void *data, size_t length);
+void free_reader(Reader_t *reader);
+real_t parse_real(const char *text, char **end);
+void write_complex(FILE *stream, const Complex_t *values, size_t count, bool shortest);
@@ -1,73 +1,287 @@
-#include <stdlib.h>
-
-/** @defgroup Tools */
-
-/** @addtogroup Tools
- * @brief Provides Utility Tools
- *
- * @details Right now mostly a vector library
- *
- * @author Markus Krainz
- * @date December 2018
- *  @{
- */
-
-#include "tools.h"
-
-/**
- * @brief Initializes a vector and allocates some memory
- *
- * @detail Terminates the application if memory allocation fails
- * @param myvect The vector to be initialized
- */
-void init_myvect(Myvect_t *myvect) {
-  myvect->data = malloc(sizeof(float) * INITIAL_ARRAY_CAPACITY);
-  if(unlikely(myvect->data == NULL)){
-    //out of memory
-    exit(EXIT_FAILURE);
-  }
-  myvect->size = 0;
-  myvect->capacity = INITIAL_ARRAY_CAPACITY;
-}
-
-/**
- * @brief Stores a new Float in a vector
- *
- * @detail Terminates the application if memory allocation fails,
- * or if passed an invalid vector.
- * @param myvect The vector
- * @param data the float to be stored in the vector
- */
-void push_myvect(Myvect_t *myvect, float data) {
-  if (unlikely(myvect->size == myvect->capacity)) {
-    if (unlikely(myvect->capacity == 0)) {
-      // using a myvect that has not been initialized or already freed
-      exit(EXIT_FAILURE);
-    }
-
-    myvect->capacity *= 2;
-    myvect->data = realloc(myvect->data, sizeof(float) * myvect->capacity);
-    if(unlikely(myvect->data == NULL)){
-      //out of memory
-      exit(EXIT_FAILURE);
-    }
-  }
-  myvect->data[myvect->size] = data;
-  myvect->size++;
-}
-
-/**
- * @brief Frees a vector
- *
- * @detail Frees the internal memory of vector.
- * After this function has been called do not reuse the vector.
- * If the vector structure was allocated on the heap do not forget to free it separately!
- * @param myvect The vector
- */
-void freedata_myvect(Myvect_t *myvect) {
-  free(myvect->data);
-  myvect->size = 0;
-  myvect->capacity = 0;
-}
-
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @defgroup Tools */
+
+/** @addtogroup Tools
+ * @brief Provides Utility Tools
+ *
+ * @details Right now mostly a vector library, an arena, reading and writing binary data
+ * between processes and replacing files without readers seeing half of them.
+ * All memory is aligned to MEMORY_ALIGNMENT bytes for SIMD loads. Big allocations are aligned
+ * to HUGE_PAGE_SIZE and the kernel is asked to back them with huge pages, which saves TLB misses
+ * when a transform walks through millions of values.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+#include "tools.h"
+
+/**
+ * @brief Initializes a vector and allocates some memory
+ *
+ * @detail Terminates the application if memory allocation fails
+ * @param myvect The vector to be initialized
+ */
+void init_myvect(Myvect_t *myvect) {
+  myvect->data = alloc_aligned(sizeof(real_t) * INITIAL_ARRAY_CAPACITY);
+  myvect->size = 0;
+  myvect->capacity = INITIAL_ARRAY_CAPACITY;
+}
+
+/**
+ * @brief Makes room for at least capacity values in a vector
+ *
+ * @detail Moves the values to a new allocation if the vector is too small, so this should be
+ * called once with the expected size before values are pushed.
+ * Terminates the application if memory allocation fails,
+ * or if passed an invalid vector.
+ * @param myvect The vector
+ * @param capacity the number of values the vector can hold afterwards without moving
+ */
+void reserve_myvect(Myvect_t *myvect, size_t capacity) {
+  if (capacity <= myvect->capacity) {
+    return;
+  }
+  if (unlikely(myvect->capacity == 0)) {
+    // using a myvect that has not been initialized or already freed
+    exit(EXIT_FAILURE);
+  }
+
+  // realloc would not keep the alignment
+  real_t *data = alloc_aligned(sizeof(real_t) * capacity);
+  memcpy(data, myvect->data, sizeof(real_t) * myvect->size);
+  free(myvect->data);
+  myvect->data = data;
+  myvect->capacity = capacity;
+}
+
+/**
+ * @brief Stores a new value in a vector
+ *
+ * @detail Terminates the application if memory allocation fails,
+ * or if passed an invalid vector.
+ * @param myvect The vector
+ * @param data the value to be stored in the vector
+ */
+void push_myvect(Myvect_t *myvect, real_t data) {
+  if (unlikely(myvect->size == myvect->capacity)) {
+    reserve_myvect(myvect, 2 * myvect->capacity);
+  }
+  myvect->data[myvect->size] = data;
+  myvect->size++;
+}
+
+/**
+ * @brief Frees a vector
+ *
+ * @detail Frees the internal memory of vector.
+ * After this function has been called do not reuse the vector.
+ * If the vector structure was allocated on the heap do not forget to free it separately!
+ * @param myvect The vector
+ */
+void freedata_myvect(Myvect_t *myvect) {
+  free(myvect->data);
+  myvect->size = 0;
+  myvect->capacity = 0;
+}
+
+/**
+ * @brief Allocates aligned memory
+ *
+ * @detail The memory is aligned to MEMORY_ALIGNMENT bytes, or to HUGE_PAGE_SIZE bytes if there
+ * are that many, and is freed with free().
+ * Terminates the application if memory allocation fails.
+ * @param size number of bytes
+ * @return the memory
+ */
+void *alloc_aligned(size_t size) {
+  const bool huge = size >= HUGE_PAGE_SIZE;
+  void *data;
+  if (unlikely(posix_memalign(&data, huge ? HUGE_PAGE_SIZE : MEMORY_ALIGNMENT,
+                              size > 0 ? size : 1) != 0)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+#ifdef MADV_HUGEPAGE
+  if (huge) {
+    // only advice, the memory works the same without huge pages
+    madvise(data, size / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+  }
+#endif
+  return data;
+}
+
+/**
+ * @brief Initializes an arena with one allocation
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @param arena The arena to be initialized
+ * @param size number of bytes, the sum of ARENA_BLOCK_SIZE() of all blocks that are allocated
+ */
+void init_arena(Arena_t *arena, size_t size) {
+  arena->data = alloc_aligned(size);
+  arena->size = size;
+  arena->used = 0;
+}
+
+/**
+ * @brief Allocates a block of an arena
+ *
+ * @detail Terminates the application if the arena is too small.
+ * @param arena The arena
+ * @param size number of bytes
+ * @return the block, aligned to MEMORY_ALIGNMENT bytes
+ */
+void *alloc_arena(Arena_t *arena, size_t size) {
+  const size_t block = ARENA_BLOCK_SIZE(size);
+  if (unlikely(block > arena->size - arena->used)) {
+    // the arena was initialized with a wrong size
+    exit(EXIT_FAILURE);
+  }
+  void *data = arena->data + arena->used;
+  arena->used += block;
+  return data;
+}
+
+/**
+ * @brief Frees an arena and all of its blocks
+ *
+ * @detail After this function has been called do not reuse the arena or its blocks.
+ * @param arena The arena
+ */
+void free_arena(Arena_t *arena) {
+  free(arena->data);
+  arena->data = NULL;
+  arena->size = 0;
+  arena->used = 0;
+}
+
+/**
+ * @brief Writes several blocks of data completely
+ *
+ * @detail Takes care of partial writes and interrupts. iov is modified in the process.
+ * @param fd file descriptor to write to
+ * @param iov the blocks, in the order they are to be written
+ * @param iovcnt number of blocks
+ * @return 0 on success, -1 on failure and errno is set
+ */
+int write_all(int fd, struct iovec *iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t written = writev(fd, iov, iovcnt);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+
+    // skip everything that has been written
+    while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Reads exactly length bytes
+ *
+ * @param fd file descriptor to read from
+ * @param data where the bytes are stored
+ * @param length number of bytes to read
+ * @return 0 on success, -1 on failure or if the input ends early and errno is set
+ */
+int read_all(int fd, void *data, size_t length) {
+  while (length > 0) {
+    const ssize_t res = read(fd, data, length);
+    if (res == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (res == 0) {
+      errno = EPIPE;
+      return -1;
+    }
+    data = (char *)data + res;
+    length -= res;
+  }
+  return 0;
+}
+
+/**
+ * @brief Creates a temporary file next to a file, to be moved over it by replace_file()
+ *
+ * @detail The temporary file gets the permissions of a new file, and readers of path never see
+ * it half written. Terminates the application if memory allocation fails.
+ * @param path the file to be replaced
+ * @param temporary set to the name of the temporary file, which replace_file() frees
+ * @return the temporary file opened for writing, or NULL on failure and errno is set
+ */
+FILE *create_replacement(const char *path, char **temporary) {
+  const size_t length = strlen(path) + sizeof(".XXXXXX");
+  *temporary = malloc(length);
+  if (unlikely(*temporary == NULL)) {
+    // out of memory
+    exit(EXIT_FAILURE);
+  }
+  snprintf(*temporary, length, "%s.XXXXXX", path);
+
+  const int fd = mkstemp(*temporary);
+  if (fd == -1) {
+    free(*temporary);
+    *temporary = NULL;
+    return NULL;
+  }
+  const mode_t mask = umask(0);
+  umask(mask);
+  FILE *file = fchmod(fd, 0666 & ~mask) == 0 ? fdopen(fd, "w") : NULL;
+  if (file == NULL) {
+    const int error = errno;
+    close(fd);
+    remove(*temporary);
+    free(*temporary);
+    *temporary = NULL;
+    errno = error;
+  }
+  return file;
+}
+
+/**
+ * @brief Closes a file from create_replacement() and moves it over the file it replaces
+ *
+ * @detail If anything was not written, the temporary file is removed and path is left alone.
+ * @param file the temporary file
+ * @param temporary its name, which is freed
+ * @param path the file to be replaced
+ * @return whether path was replaced, errno is set if not
+ */
+bool replace_file(FILE *file, char *temporary, const char *path) {
+  bool valid = !ferror(file);
+  valid = fclose(file) == 0 && valid;
+  valid = valid && rename(temporary, path) == 0;
+  if (!valid) {
+    const int error = errno;
+    remove(temporary);
+    errno = error;
+  }
+  free(temporary);
+  return valid;
+}
+
 /** @}*/
\ No newline at end of file
@@ -1,19 +1,84 @@
-#pragma once
-
-#include <stdio.h>
-
-#define likely(x) __builtin_expect(!!(x), 1)
-#define unlikely(x) __builtin_expect(!!(x), 0)
-
-#define PI 3.141592654
-
-typedef struct myvect {
-  float *data;
-  size_t size;
-  size_t capacity;
-} Myvect_t;
-
-#define INITIAL_ARRAY_CAPACITY 2
-void init_myvect(Myvect_t *myvect);
-void push_myvect(Myvect_t *myvect, float data);
-void freedata_myvect(Myvect_t *myvect);
\ No newline at end of file
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/uio.h>
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+
+/** π with more digits than even long double can hold */
+#define PI 3.14159265358979323846264338327950288L
+
+#if defined(REAL_LONG_DOUBLE)
+typedef long double real_t;
+/** printf length modifier for real_t */
+#define REAL_PRINTF_MODIFIER "L"
+#define strtoreal strtold
+#define REAL_NAME "long double"
+#elif defined(REAL_DOUBLE)
+typedef double real_t;
+#define REAL_PRINTF_MODIFIER ""
+#define strtoreal strtod
+#define REAL_NAME "double"
+#else
+/** The type of all values and results, chosen at build time */
+typedef float real_t;
+#define REAL_PRINTF_MODIFIER ""
+#define strtoreal strtof
+#define REAL_NAME "float"
+#endif
+
+typedef struct myvect {
+  real_t *data;
+  size_t size;
+  size_t capacity;
+} Myvect_t;
+
+#define INITIAL_ARRAY_CAPACITY 2
+void init_myvect(Myvect_t *myvect);
+void reserve_myvect(Myvect_t *myvect, size_t capacity);
+void push_myvect(Myvect_t *myvect, real_t data);
+void freedata_myvect(Myvect_t *myvect);
+
+/** Alignment of all vectors and arena blocks, enough for the widest SIMD loads */
+#define MEMORY_ALIGNMENT 64
+/** Allocations of at least this size are aligned to it, so they can be backed by huge pages */
+#define HUGE_PAGE_SIZE (1 << 21)
+
+void *alloc_aligned(size_t size);
+
+/** Hands out blocks of one allocation, which are all freed together */
+typedef struct arena {
+  char *data;
+  size_t size;
+  size_t used;
+} Arena_t;
+
+/** Bytes an arena needs for a block of size bytes, including its alignment */
+#define ARENA_BLOCK_SIZE(size)                                                                \
+  (((size) + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT)
+
+void init_arena(Arena_t *arena, size_t size);
+void *alloc_arena(Arena_t *arena, size_t size);
+void free_arena(Arena_t *arena);
+
+/** Starts binary data between forkFFT processes, no text float starts with '\0' */
+#define BINARY_MAGIC "\0FFT"
+#define BINARY_MAGIC_LENGTH 4
+
+/** Precedes the raw elements of binary data, which are in the byte order of the machine */
+typedef struct binaryHeader {
+  char magic[BINARY_MAGIC_LENGTH];
+  /** size of one element in bytes, to detect mismatching builds */
+  uint32_t element_size;
+  uint64_t count;
+} BinaryHeader_t;
+
+int write_all(int fd, struct iovec *iov, int iovcnt);
+int read_all(int fd, void *data, size_t length);
+
+FILE *create_replacement(const char *path, char **temporary);
+bool replace_file(FILE *file, char *temporary, const char *path);
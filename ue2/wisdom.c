@@ -0,0 +1,198 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @defgroup Wisdom */
+
+/** @addtogroup Wisdom
+ * @brief Remembers how transforms of a size are calculated fastest
+ *
+ * @details The planner of forkFFT times the engines, recursion depths and radices for a size
+ * and stores its choice in a wisdom file. Later runs load the file and use the choice right
+ * away, without measuring again. Entries are keyed by the size, the direction and the
+ * precision of the build, so builds with different PRECISION can share one file.
+ * The file is text with one entry per line:
+ *
+ *     n forward|inverse float|double|long-double engine depth radix
+ *
+ * Empty lines and lines starting with '#' are ignored. The engine has to be one of forkFFT's,
+ * the depth less than WISDOM_MAX_DEPTH and the radix 2 or 4, otherwise the file is rejected.
+ *
+ * @author Markus Krainz
+ * @date December 2018
+ *  @{
+ */
+
+#include "tools.h"
+#include "wisdom.h"
+
+#if defined(REAL_LONG_DOUBLE)
+const char *const WISDOM_PRECISION = "long-double";
+#elif defined(REAL_DOUBLE)
+const char *const WISDOM_PRECISION = "double";
+#else
+const char *const WISDOM_PRECISION = "float";
+#endif
+
+const char *const WISDOM_ENGINES[WISDOM_ENGINE_COUNT] = {"process", "sequential", "shm", "thread"};
+
+/** The line at the top of every wisdom file */
+#define WISDOM_COMMENT "# forkFFT wisdom: n direction precision engine depth radix\n"
+
+/**
+ * @brief Initializes an empty wisdom
+ *
+ * @param wisdom The wisdom to be initialized
+ */
+void init_wisdom(Wisdom_t *wisdom) {
+  wisdom->entries = NULL;
+  wisdom->count = 0;
+  wisdom->capacity = 0;
+}
+
+/**
+ * @brief Returns whether an entry read from a file names an engine, depth and radix forkFFT has
+ */
+static bool isValidEntry(const WisdomEntry_t *entry) {
+  bool known = false;
+  for (size_t i = 0; i < WISDOM_ENGINE_COUNT; ++i) {
+    known = known || strcmp(entry->engine, WISDOM_ENGINES[i]) == 0;
+  }
+  return known && entry->n > 0 && entry->depth >= 0 && entry->depth < WISDOM_MAX_DEPTH &&
+         (entry->radix == 2 || entry->radix == 4);
+}
+
+/**
+ * @brief Adds the entries of a wisdom file
+ *
+ * @detail A file that does not exist yet counts as empty, so the first planning run can create
+ * it. Terminates the application if memory allocation fails.
+ * @param wisdom The wisdom
+ * @param path the file
+ * @param line_number is set to the number of the first invalid line, or to 0 if the file cannot
+ * be read
+ * @return true on success, false if the file cannot be read or has an invalid line
+ */
+bool load_wisdom(Wisdom_t *wisdom, const char *path, size_t *line_number) {
+  *line_number = 0;
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return errno == ENOENT;
+  }
+
+  char line[256];
+  size_t number = 0;
+  bool valid = true;
+  while (valid && fgets(line, sizeof(line), file) != NULL) {
+    ++number;
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+
+    WisdomEntry_t entry;
+    char direction[WISDOM_NAME_LENGTH];
+    int end = 0;
+    // the field widths are WISDOM_NAME_LENGTH - 1
+    if (sscanf(line, "%zu %15s %15s %15s %ld %zu %n", &entry.n, direction, entry.precision,
+               entry.engine, &entry.depth, &entry.radix, &end) != 6 ||
+        line[end] != '\0' ||
+        (strcmp(direction, "forward") != 0 && strcmp(direction, "inverse") != 0) ||
+        !isValidEntry(&entry)) {
+      *line_number = number;
+      valid = false;
+      break;
+    }
+    entry.inverse = strcmp(direction, "inverse") == 0;
+    put_wisdom(wisdom, &entry);
+  }
+
+  valid = valid && !ferror(file);
+  fclose(file);
+  return valid;
+}
+
+/**
+ * @brief Looks up the entry of a size and direction for the precision of this build
+ *
+ * @param wisdom The wisdom
+ * @param n size of the transform
+ * @param inverse the direction
+ * @return the entry, or NULL if this size has not been planned
+ */
+const WisdomEntry_t *find_wisdom(const Wisdom_t *wisdom, size_t n, bool inverse) {
+  for (size_t i = 0; i < wisdom->count; ++i) {
+    const WisdomEntry_t *entry = &wisdom->entries[i];
+    if (entry->n == n && entry->inverse == inverse &&
+        strcmp(entry->precision, WISDOM_PRECISION) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Adds an entry, or replaces the one with the same key
+ *
+ * @detail Terminates the application if memory allocation fails.
+ * @param wisdom The wisdom
+ * @param entry the entry, which is copied
+ */
+void put_wisdom(Wisdom_t *wisdom, const WisdomEntry_t *entry) {
+  for (size_t i = 0; i < wisdom->count; ++i) {
+    WisdomEntry_t *old = &wisdom->entries[i];
+    if (old->n == entry->n && old->inverse == entry->inverse &&
+        strcmp(old->precision, entry->precision) == 0) {
+      *old = *entry;
+      return;
+    }
+  }
+
+  if (wisdom->count == wisdom->capacity) {
+    wisdom->capacity = wisdom->capacity > 0 ? 2 * wisdom->capacity : 16;
+    wisdom->entries = realloc(wisdom->entries, sizeof(WisdomEntry_t) * wisdom->capacity);
+    if (unlikely(wisdom->entries == NULL)) {
+      // out of memory
+      exit(EXIT_FAILURE);
+    }
+  }
+  wisdom->entries[wisdom->count++] = *entry;
+}
+
+/**
+ * @brief Writes all entries to a wisdom file
+ *
+ * @detail The entries are written to a new temporary file next to it first, which then replaces
+ * the file, so concurrent runs never load half of a file or write into each other's. The file
+ * gets the permissions fopen() would give it.
+ * @param wisdom The wisdom
+ * @param path the file
+ * @return true on success, false if writing fails
+ */
+bool save_wisdom(const Wisdom_t *wisdom, const char *path) {
+  char *temporary;
+  FILE *file = create_replacement(path, &temporary);
+  if (file == NULL) {
+    return false;
+  }
+  fputs(WISDOM_COMMENT, file);
+  for (size_t i = 0; i < wisdom->count; ++i) {
+    const WisdomEntry_t *entry = &wisdom->entries[i];
+    fprintf(file, "%zu %s %s %s %ld %zu\n", entry->n, entry->inverse ? "inverse" : "forward",
+            entry->precision, entry->engine, entry->depth, entry->radix);
+  }
+  return replace_file(file, temporary, path);
+}
+
+/**
+ * @brief Frees a wisdom
+ *
+ * @detail After this function has been called do not reuse the wisdom.
+ * @param wisdom The wisdom
+ */
+void free_wisdom(Wisdom_t *wisdom) {
+  free(wisdom->entries);
+  init_wisdom(wisdom);
+}
+
+/** @}*/
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Longest name of a precision or an engine in a wisdom file, including the terminating '\0' */
+#define WISDOM_NAME_LENGTH 16
+
+/** Name of the precision of this build in wisdom files, without spaces */
+extern const char *const WISDOM_PRECISION;
+
+/** Number of engines of forkFFT */
+#define WISDOM_ENGINE_COUNT 4
+
+/** Names of the engines of forkFFT in wisdom files, in the order of its Engine_t */
+extern const char *const WISDOM_ENGINES[WISDOM_ENGINE_COUNT];
+
+/** Levels of processes or splits of an entry are less than this, as sizes halve at most this
+ * often */
+#define WISDOM_MAX_DEPTH 64
+
+/** How the planner chose to calculate one transform */
+typedef struct wisdomEntry {
+  /** the key: size, direction and the precision of the build that measured it */
+  size_t n;
+  bool inverse;
+  char precision[WISDOM_NAME_LENGTH];
+  /** the choice */
+  char engine[WISDOM_NAME_LENGTH];
+  long depth;
+  size_t radix;
+} WisdomEntry_t;
+
+/** All entries of a wisdom file, including those of other precisions */
+typedef struct wisdom {
+  WisdomEntry_t *entries;
+  size_t count;
+  size_t capacity;
+} Wisdom_t;
+
+void init_wisdom(Wisdom_t *wisdom);
+bool load_wisdom(Wisdom_t *wisdom, const char *path, size_t *line_number);
+const WisdomEntry_t *find_wisdom(const Wisdom_t *wisdom, size_t n, bool inverse);
+void put_wisdom(Wisdom_t *wisdom, const WisdomEntry_t *entry);
+bool save_wisdom(const Wisdom_t *wisdom, const char *path);
+void free_wisdom(Wisdom_t *wisdom);